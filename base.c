@@ -28,6 +28,15 @@
 #include             "string.h"
 #include             "my_globals.h"
 #include             "list.h"
+#include             "timer_wheel.h"
+#include             "scheduler.h"
+#include             "frame_bitmap.h"
+#include             "swap.h"
+#include             "pager.h"
+#include             "disk.h"
+#include             "wait_queue.h"
+#include             "buffer_cache.h"
+#include             "volume.h"
 
 extern INT16 Z502_MODE;
 
@@ -43,18 +52,109 @@ UINT16 virtual_address;
 INT32 gen_pid = 1;
 PCB                *current_PCB = NULL;    // this is the currently running PCB
 PCB                *root_process_pcb = NULL;
-LinkedList         timer_queue;            // Holds all processes that are currently waiting for the timer queue
+TimerWheel         timer_queue;            // Holds all processes that are currently waiting for the timer
 LinkedList         process_list;           // Holds all processes that exist
 
-PCB**              disk_queue;             // Holds all processes trying to use the disk
+DiskQueue          disk_queue[MAX_NUMBER_OF_DISKS + 1]; // the transfers each disk is doing and has waiting
+WaitQueue          disk_waiters[MAX_BLOCK_DEVICES + 1]; // processes blocked on a transfer of theirs on each disk or volume
+WaitQueue          message_waiters;        // processes blocked in RECEIVE_MESSAGE
+WaitQueue          page_waiters;           // processes blocked on one of their pages moving to or from swap
+WaitQueue          pageout_io_waiters;     // the page-out daemon, waiting for one of its transfers
+WaitQueue          pageout_idle_waiters;   // the page-out daemon, waiting for frames to run low
+WaitQueue          frame_waiters;          // faults with no frame to replace, waiting for one to come free
+DISK_POLICY*       disk_policy = NULL;     // orders each disk's queue, set with -disk_sched=
+long               disk_requests = 0;      // transfers the disks have finished
+long               disk_wait_total = 0;    // ticks from handing a transfer to a disk to its finishing
+long               disk_wait_worst = 0;
+INT32              ssd_disks = DEFAULT_SSD_DISKS; // set with -ssd_disks=
+long               disk_trims = 0;         // freed swap sectors trimmed on solid state disks
+INT32              track_cache = DEFAULT_TRACK_CACHE; // set with -track_cache=, 0 turns it off
+INT32              track_policy = DISK_CACHE_AHEAD; // what the track cache keeps, set with -track_policy=
+INT32              write_cache = DEFAULT_WRITE_CACHE; // set with -write_cache=, 0 turns it off
+BOOL               fsync_fua = FALSE;      // FLUSH_DISK writes with FUA rather than flushing after, set with -fsync=
+INT32              unflushed_writes[MAX_NUMBER_OF_DISKS + 1]; // writes each disk has taken into its write cache since its last flush
+long               cache_flushes = 0;      // flushes of the disks' write caches
+long               fua_writes = 0;         // writes that went past them
+Volume             volumes[MAX_VOLUMES];   // by disk number, from MAX_NUMBER_OF_DISKS + 1 on, set up with -volume=
+INT32              volume_count = 0;
+INT32              stripe_sectors = DEFAULT_STRIPE; // set with -stripe=
+INT32              mirror_policy = MIRROR_LEAST_BUSY; // which member of a mirror a read goes to, set with -mirror_read=
+BufferCache        buffer_cache = NULL;    // sectors read and written lately, NULL when it is turned off
+INT32              cache_buffers = DEFAULT_CACHE_BUFFERS; // set with -cache_buffers=, 0 turns the cache off
+WaitQueue          buffer_waiters;         // processes waiting for somebody to finish with a buffer
+long               cache_hits = 0;         // DISK_READs answered from the cache
+long               cache_misses = 0;       // and those that had to go to the disk
+long               cache_writebacks = 0;   // dirty buffers written back to make room
+long               writes_merged = 0;      // DISK_WRITEs to a buffer that was dirty already
+long               write_stall_total = 0;  // ticks DISK_WRITE callers spent waiting in the OS
+long               disk_write_calls = 0;
+PCB*               flush_pcb = NULL;       // the flush daemon, started the first time a buffer is written to
+WaitQueue          flush_idle_waiters;     // the flush daemon, waiting for a buffer to be written to
+INT32              flush_interval = DEFAULT_FLUSH_INTERVAL; // set with -flush_interval=
+long               flush_writes = 0;       // buffers the flush daemon wrote back
+long               sync_writes = 0;        // buffers written back for FLUSH_DISK
+WaitQueue          async_waiters;          // processes blocked in DISK_WAIT or DISK_WAIT_ANY
+long               async_requests = 0;     // DISK_READ_ASYNCs and DISK_WRITE_ASYNCs started
+long               async_cache_hits = 0;   // reads of those answered from the buffer cache
+long               async_messages = 0;     // finished ones posted to a mailbox
+WaitQueue          vector_waiters;         // processes blocked in DISK_READV or DISK_WRITEV
+long               vector_calls = 0;       // DISK_READVs and DISK_WRITEVs
+long               vector_segments = 0;    // sectors they moved
+long               vector_cache_hits = 0;  // sectors read by them that came from the buffer cache
 FRAME*             frame_list;
-SHADOW_TABLE*     shadow_table;
+SwapArea           swap_area;              // where pages go when their frame is taken away
+INT32              swap_disks = DEFAULT_SWAP_DISKS; // disks given over to swap, set with -swap_disks=
+INT32              swap_volume = -1;       // what the swap disks are put together as, -1 for nothing, set with -swap_volume=
+INT32              swap_first_disk;        // the swap area is swap_devices disks or volumes from here on
+INT32              swap_devices;
+FrameBitmap        free_frames;            // which frames nobody owns
+PAGER_POLICY*      pager = NULL;           // picks which page to evict, set with -pager=
+long               page_faults = 0;
+long               page_replacements = 0;
+long               dirty_replacements = 0;    // replacements that had to write the page out first
+long               swap_ins = 0;              // faults that read the page back from swap
+long               fault_time_total = 0;      // ticks spent handling page faults
+long               fault_time_worst = 0;
+INT32              zero_frame = -1;           // read only frame of zeros for pages nobody has written to yet
+BOOL               zero_page_enabled = FALSE; // set with -zero_page=
+long               zero_fills = 0;            // faults answered with the zero frame
+long               write_faults = 0;          // writes to a page mapped read only
+long               cow_copies = 0;            // of those, how many needed a frame of their own
+long               pages_shared = 0;          // pages handed to a new process copy on write
+
+PCB*               pageout_pcb = NULL;        // the page-out daemon, started the first time frames run low
+BOOL               pageout_enabled = TRUE;    // set with -pageout=
+INT32              free_frames_low = 0;       // the daemon wakes below this many free frames
+INT32              free_frames_high = 0;      // and frees frames until there are this many
+PAGER_IO           pager_io[MAX_NUMBER_OF_DISKS + 1]; // the transfer the daemon looks after on each disk
+INT32              cleans_in_flight = 0;      // of those, writes that will free a frame
+INT32              readaheads_in_flight = 0;  // and reads ahead of a fault
+long               pageout_frames = 0;        // frames the daemon freed
+long               pageout_writes = 0;        // of those, how many it had to write out first
+INT32              readahead_max = DEFAULT_READAHEAD; // most pages read ahead of a fault, set with -readahead=
+long               prefetches = 0;            // pages read ahead
+long               prefetch_hits = 0;         // of those, how many were used before they were evicted
+long               prefetch_waste = 0;        // and how many were evicted without being used
+INT32              phys_mem_pgs = PHYS_MEM_PGS; // frames the OS manages, set with -frames=
+long               ws_window = DEFAULT_WS_WINDOW; // working set window for -pager=wsclock, set with -ws_window=
 
-int                total_timer_pid = 0;    //counter for the number of PCBs in the timer queue
 INT32              last_context_switch = 0;  // the number of ticks since the last context switch
-
-BOOL add_next_to_timer = FALSE;
-BOOL interrupt_lock = FALSE;
+INT32              timer_armed_deadline = -1; // the wake up time the hardware timer is currently set for
+
+INT32              time_quantum = DEFAULT_QUANTUM; // length of a time slice, 0 turns preemption off
+INT32              slice_deadline = -1;       // when the running process's time slice runs out, -1 if there is none
+BOOL               preempt_pending = FALSE;   // set by the timer interrupt, acted on the next time the process enters the OS
+INT32              dispatch_count = 0;        // total number of times a process has been switched in
+SCHEDULER_POLICY*  scheduler = NULL;          // decides who runs next, picked with -sched=
+BOOL               direct_handoff = TRUE;     // blocking processes switch straight to the next one instead of going through root
+long               hardware_switches = 0;     // every call to Z502SwitchContext, root included
+long               blocking_operations = 0;   // number of times a process gave up the CPU to wait on something
+BOOL               directed_yield = FALSE;    // a message sender hands the CPU straight to the receiver it woke up
+INT32              donated_slice = -1;        // what is left of the sender's slice, given to the receiver
+long               directed_yields = 0;
+
+PROCESS_STATS*     process_stats = NULL;      // scheduling statistics, indexed by pid
+INT32              process_stats_length = 0;
 
 // if these flags are set to 1, print out state information
 int print_schedule = 0;
@@ -65,7 +165,10 @@ char *call_names[] = { "mem_read ", "mem_write",
                        "get_pid  ", "create   ", "term_proc",
                        "suspend  ", "resume   ", "ch_prior ",
                        "send     ", "receive  ", "disk_read",
-                       "disk_wrt ", "def_sh_ar" };
+                       "disk_wrt ", "def_sh_ar", "page_flts",
+                       "resident ", "res_limit", "cr_copy  ", "flush    ",
+                       "rd_async ", "wr_async ", "disk_wait", "wait_any ",
+                       "disk_poll", "disk_rdv ", "disk_wrv " };
 
 /************************************************************************
     INTERRUPT_HANDLER
@@ -97,20 +200,27 @@ void    interrupt_handler( void ) {
                     break;
                 }
 
-                if (timer_queue->data == NULL) {
-                    break;
-                }
-                PCB* waking_process = remove_from_list(timer_queue, timer_queue->data->pid);
-                waking_process->state = READY;
+                lock_timer();
+                timer_armed_deadline = -1;      // the hardware timer is no longer running
 
-                //add the next one to the queue
-                if (get_length(timer_queue) == 0) {
-                    interrupt_lock = FALSE;
+                // wake up everyone who is due, not just the head of the queue
+                PCB* waking_process = timer_wheel_next_expired(timer_queue, Time);
+                while (waking_process != NULL) {
+                    if (waking_process->state == SLEEPING)
+                        waking_process->state = READY;
+                    waking_process = timer_wheel_next_expired(timer_queue, Time);
                 }
 
-                if (get_length(timer_queue) > 0) {
-                    add_next_to_timer = TRUE;
+                // the running process has used up its slice.  We can't switch from the
+                // interrupt thread, so it gets preempted the next time it enters the OS
+                if (slice_deadline != -1 && Time >= slice_deadline) {
+                    slice_deadline = -1;
+                    preempt_pending = TRUE;
                 }
+
+                // and go back to sleep until the next deadline
+                reset_timer();
+                unlock_timer();
                 break;
 
             case(DISK_INTERRUPT):
@@ -133,22 +243,34 @@ void    interrupt_handler( void ) {
                     break;
                 }
 
+                // whoever is waiting on the disk is let go, and the next transfer
+                // started, under the disk lock so nobody can start on the disk in between
                 INT32 disk_status;
-                MEM_WRITE(Z502DiskSetID, &(disk_id));
+                lock_disk();
+                MEM_WRITE(Z502DiskSetID, &disk_id);
                 MEM_READ(Z502DiskStatus, &disk_status);
 
                 if (disk_status == DEVICE_FREE) {
-                    if (disk_queue[disk_id] != NULL) {
-                        //I believe this is automatically done
-                        disk_queue[disk_id]->state = READY;
-                        disk_queue[disk_id] = NULL;
+                    INT32 disk_tag;
+                    DISK_REQUEST* finished;
+
+                    // the disk says which of its transfers this is for
+                    MEM_READ(Z502DiskCompletedTag, &disk_tag);
+                    finished = disk_queue_finish(disk_queue[disk_id], disk_tag);
+                    if (finished != NULL) {
+                        finish_disk_request(finished);
+                        dispatch_disk(disk_id);
+                        unlock_disk();
                     }
                     else {
-                        printf("Error, no PCB is available for this request\n");
+                        unlock_disk();
+                        printf("Error, no request is waiting on this disk\n");
                     }
                 }
-                else
+                else {
+                    unlock_disk();
                     printf("Write is not complete yet\n");
+                }
 
             }
             break;
@@ -178,10 +300,12 @@ void    fault_handler( void )
     INT32       Index = 0;
     INT32       frame = -1;
     INT32       frame_id;
-    INT32       new_frame = 0;
-    INT32       lock_result;
-    int         out_of_frames = 0;
     INT32       i;
+    UINT16*     page_table;
+    PROCESS_STATS* stats;
+    INT32       fault_start;
+    INT32       fault_end;
+    char        zeros[PGSIZE];
 
     // Get cause of interrupt
     MEM_READ(Z502InterruptDevice, &device_id );
@@ -203,79 +327,115 @@ void    fault_handler( void )
                 Z502Halt();
             }
 
-            // if the table has not been created yet, create it
-            if(Z502_PAGE_TBL_LENGTH == 0) {
-                // initialize the page table
-                Z502_PAGE_TBL_LENGTH = VIRTUAL_MEM_PGS;
-                Z502_PAGE_TBL_ADDR = (UINT16*) calloc(sizeof(UINT16), Z502_PAGE_TBL_LENGTH);
+            // set up the frame list the first time anyone faults
+            if (frame_list == NULL) {
+                frame_list = (FRAME*) calloc(sizeof(FRAME), phys_mem_pgs);
+                free_frames = create_frame_bitmap(phys_mem_pgs);
+                swap_area = create_swap_area(swap_first_disk, swap_devices, block_device_sectors(swap_first_disk),
+                                             disk_is_free);
 
-                // allocate the frame list
-                frame_list = (FRAME*) calloc(sizeof(FRAME), PHYS_MEM_PGS);
-                shadow_table = (SHADOW_TABLE*) calloc(sizeof(SHADOW_TABLE), PHYS_MEM_PGS);
+                // the daemon's watermarks; there is no reserve worth keeping in a tiny memory
+                free_frames_low = phys_mem_pgs / PAGEOUT_LOW_SHARE;
+                free_frames_high = 2 * free_frames_low;
+                if (free_frames_low < 1)
+                    pageout_enabled = FALSE;
 
                 // init the frame list
-                for(i = 0; i < (int) PHYS_MEM_PGS; i++) {
+                for(i = 0; i < phys_mem_pgs; i++) {
                     frame_list[i].frame_id = i;
                     frame_list[i].page_id = -1;
-                    frame_list[i].pid = current_PCB->pid;
+                    frame_list[i].pid = -1;
                     frame_list[i].in_use = FALSE;
+                    frame_list[i].locked = FALSE;
+                    frame_list[i].prefetched = FALSE;
+                    frame_list[i].sharers = 0;
+                }
 
-                    shadow_table[i].frame_id = i;
-                    shadow_table[i].page_id = -1;
-                    shadow_table[i].disk_id = -1;
-                    shadow_table[i].in_use = FALSE;
+                // the zero frame never belongs to anyone and never goes anywhere
+                if (zero_page_enabled && phys_mem_pgs > 1) {
+                    zero_frame = frame_bitmap_alloc(free_frames);
+                    frame_list[zero_frame].in_use = TRUE;
+                    frame_list[zero_frame].locked = TRUE;
+                    memset(zeros, 0, PGSIZE);
+                    Z502WritePhysicalMemory(zero_frame, zeros);
                 }
             }
 
-            if(out_of_frames == 0) {
-                if(Z502_PAGE_TBL_ADDR[status] == NULL) {
-                    // The user is requesting a page that has not yet been created
-                    frame = find_empty_frame(status);
+            // every process has its own page table, and the hardware is using the current one
+            page_table = current_PCB->pagetable;
 
-                    //make sure we are aware that we are out of memory
-                    if(frame == PHYS_MEM_PGS) {
-                        out_of_frames = 1;
-                    }
+            // a write to a page that is mapped read only, because it is shared
+            if ((page_table[status] & PTBL_VALID_BIT) && (page_table[status] & PTBL_READ_ONLY_BIT)) {
+                write_faults++;
+                copy_on_write(status);
+                memory_printer();
+                break;
+            }
 
-                    if(frame == -1) {
-                        //TODO: FIX THIS LATER
-                        Z502Halt();
-                    }
-                    else {
-                        // make sure the frame is not previously used
-                        frame_id = (UINT16) frame_list[frame].frame_id;
-                        Z502_PAGE_TBL_ADDR[status] = frame_id | PTBL_VALID_BIT;
-
-                        // handles locking for the current thread on this chunk of memory
-                        READ_MODIFY(MEMORY_INTERLOCK_BASE + frame, DO_LOCK, DO_NOT_SUSPEND, &lock_result);
-                        if (lock_result == FALSE)
-                            printf("Could not obtain lock!!\n");
-                    }
-                }
-                else if(!(Z502_PAGE_TBL_ADDR[status] & PTBL_VALID_BIT)) {
-                    // The requested page is invalid and is not in physical memory
-                    printf("This is not a valid page.\n");
+            if(page_table[status] & PTBL_VALID_BIT) {
+                printf("Catch all!\n");
+                break;
+            }
+
+            MEM_READ(Z502ClockStatus, &fault_start);
+
+            // count it against the process for the fault rate
+            stats = get_process_stats(current_PCB->pid);
+            if (stats != NULL)
+                stats->page_faults++;
+            page_faults++;
+
+            // it is still on its way out, from when somebody took it away from us,
+            // or on its way in because it was read ahead
+            while (current_PCB->shadow_table != NULL && current_PCB->shadow_table[status].frame_id != -1) {
+                wait_queue_add(page_waiters, current_PCB);
+                give_up_cpu();
+            }
+
+            // a read ahead got there first, and the access that faulted is about to use it
+            if (page_table[status] & PTBL_VALID_BIT)
+                page_table[status] |= PTBL_REFERENCED_BIT;
+            else if (zero_frame != -1
+                    && (current_PCB->shadow_table == NULL || !current_PCB->shadow_table[status].in_use)) {
+                // nothing was ever written to it, so it reads as zeros
+                // until the process writes to it
+                page_table[status] = (UINT16) zero_frame | PTBL_VALID_BIT | PTBL_REFERENCED_BIT | PTBL_READ_ONLY_BIT;
+                zero_fills++;
+            }
+            else {
+                // The user is requesting a page that is not in physical memory.
+                frame = take_frame(status);
+
+                // a page that was paged out before is read back in;
+                // nobody may take the frame while that is going on
+                if (current_PCB->shadow_table != NULL && current_PCB->shadow_table[status].in_use) {
+                    frame_list[frame].locked = TRUE;
+                    page_in(frame, status);
+                    frame_list[frame].locked = FALSE;
+                    frame_available();
+                    swap_ins++;
                 }
                 else {
-                    printf("Catch all!\n");
+                    // a brand new page starts out as zeros, not as whatever was in the frame
+                    memset(zeros, 0, PGSIZE);
+                    Z502WritePhysicalMemory(frame, zeros);
                 }
+
+                // it counts as referenced, since the access that faulted is about to use it
+                frame_id = (UINT16) frame_list[frame].frame_id;
+                page_table[status] = frame_id | PTBL_VALID_BIT | PTBL_REFERENCED_BIT;
             }
 
-            // this means all the frames have been used
-            if(out_of_frames == 1) {
-                // the replacement algorithm can go here
-                new_frame = page_replacement();
+            // a process working its way through memory gets its next few pages started
+            read_ahead(status);
 
-                Z502_PAGE_TBL_ADDR[status] = (UINT16) frame_list[new_frame].frame_id | PTBL_VALID_BIT;
-                frame_list[new_frame].page_id = status;
-                frame_list[new_frame].pid = current_PCB->pid;
-                frame_list[new_frame].in_use = TRUE;
+            // get the daemon going before the next fault finds nothing free
+            wake_pageout_daemon();
 
-                // handles locking for the current thread on this chunk of memory
-                READ_MODIFY(MEMORY_INTERLOCK_BASE + new_frame, DO_LOCK, DO_NOT_SUSPEND, &lock_result);
-                if (lock_result == FALSE)
-                    printf("Error, could not obtain lock!!\n");
-            }
+            MEM_READ(Z502ClockStatus, &fault_end);
+            fault_time_total += fault_end - fault_start;
+            if (fault_end - fault_start > fault_time_worst)
+                fault_time_worst = fault_end - fault_start;
 
             memory_printer();
 
@@ -293,6 +453,8 @@ void    fault_handler( void )
 
     // Clear out this device - we're done with it
     MEM_WRITE(Z502InterruptClear, &Index );
+
+    preempt_if_needed();
 }                                       /* End of fault_handler */
 
 /************************************************************************
@@ -318,9 +480,17 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
     Node*               process_node;
     INT32               tmp_pid;
     INT32               lock_result;
-    INT32               disk_status;
     INT32               disk_action;
     INT32               disk_start;
+    INT32               min_pages;
+    INT32               max_pages;
+    INT32               reserved;
+    BOOL                woken;
+    BOOL                queued;
+    INT32               async_error;
+    INT32               async_handle;
+    DISK_SEGMENT*       segments;
+    INT32               segment_count;
 
 
     call_type = (short)SystemCallData->SystemCallNumber;
@@ -385,10 +555,11 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
         case SYSNUM_SLEEP:
             printf("sleeping process: %i\n", current_PCB->pid);
             sleep_process(SystemCallData->Argument[0], current_PCB);
-            switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
+            give_up_cpu();
             break;
 
         case SYSNUM_CREATE_PROCESS:
+        case SYSNUM_CREATE_PROCESS_COPY:
             name = (char *)SystemCallData->Argument[0];
             addr = (void*) SystemCallData->Argument[1];
             priority = (int)SystemCallData->Argument[2];
@@ -400,6 +571,13 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
             else {
                 process_handle = os_make_process(name, priority, SystemCallData->Argument[4], addr, USER_MODE);
 
+                // the copy can't run until it has all of its memory
+                if (process_handle != NULL && call_type == SYSNUM_CREATE_PROCESS_COPY) {
+                    process_handle->state = SUSPEND;
+                    clone_address_space(process_handle);
+                    process_handle->state = CREATE;
+                }
+
                 if(process_handle != NULL) {
                     *(SystemCallData->Argument[4]) = ERR_SUCCESS;
                     *(SystemCallData->Argument[3]) = process_handle->pid;
@@ -481,6 +659,10 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
                     *(SystemCallData->Argument[1]) = ERR_BAD_PARAM;
                 }
                 else {
+                    // it is let go from whatever it was waiting for, and has another look when it runs
+                    lock_disk();
+                    wait_queue_remove(process_handle->wait_queue, process_handle);
+                    unlock_disk();
                     process_handle->state = READY;
                     scheduler_printer("READY");
                     *(SystemCallData->Argument[1]) = ERR_SUCCESS;
@@ -540,20 +722,22 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
                     BOOL able_to_process = FALSE;
                     msg->broadcast_message = TRUE;
                     Node *cursor = process_list;
+                    lock_disk();
                     while (cursor != NULL) {
                         if (cursor->data != NULL) {
 //                            if (cursor->data->pid != current_PCB->pid) {
                                 if(enqueue_message(cursor->data, msg))
                                     able_to_process = TRUE;
-
-                                if ((cursor->data->state == SUSPEND) && (cursor->data->suspend_reason == WAITING_FOR_MESSAGE))
-                                    cursor->data->state = READY;              //wake it up!
 //                            }
                         }
 
                         cursor = cursor->next;
                     }
 
+                    // wake everybody up to have a look
+                    wait_queue_wake_all(message_waiters);
+                    unlock_disk();
+
                     if (able_to_process)
                         *SystemCallData->Argument[3] = ERR_SUCCESS;
                     else
@@ -567,10 +751,20 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
                     else if ((message_length < 0) || (message_length > MAX_MSG))
                         *SystemCallData->Argument[3] = ERR_BAD_PARAM;
                     else {
-                        if (enqueue_message(process_handle, msg)) {
-                            if ((process_handle->state == SUSPEND) && (process_handle->suspend_reason == WAITING_FOR_MESSAGE))
-                                process_handle->state = READY;              //wake it up!
+                        // the interrupt handler posts to mailboxes too, when a DISK_*_ASYNC finishes
+                        lock_disk();
+                        queued = enqueue_message(process_handle, msg);
+                        woken = queued && wait_queue_wake(message_waiters, process_handle);
+                        unlock_disk();
+
+                        if (queued) {
                             *SystemCallData->Argument[3] = ERR_SUCCESS;
+                            if (woken) {
+                                // it is waiting on us, so let it run now if it is at least as important
+                                if (directed_yield && current_PCB != root_process_pcb &&
+                                        process_handle->priority <= current_PCB->priority)
+                                    yield_to(process_handle);
+                            }
                         }
                         else {
                             printf("Error, could not enqueue message at recipient.  Too many messages stored\n");
@@ -598,16 +792,23 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
                     *SystemCallData->Argument[5] = ERR_BAD_PARAM;
                 }
                 else {
+                    // finished DISK_*_ASYNCs that asked to be told come in as messages from ourselves.
+                    // The interrupt handler posts them, but one that found the mailbox full is still to go
+                    lock_disk();
+                    post_async_completions(current_PCB);
                     int message_index = find_message_by_source(current_PCB, tmp_pid);
                     while (message_index == -1) {
                         printf("No messages available from process: %i.  Sleeping\n", tmp_pid);
-                        current_PCB->state = SUSPEND;
-                        current_PCB->suspend_reason = WAITING_FOR_MESSAGE;
-                        switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
+                        wait_queue_add(message_waiters, current_PCB);
+                        unlock_disk();
+                        give_up_cpu();
+                        lock_disk();
+                        post_async_completions(current_PCB);
                         message_index = find_message_by_source(current_PCB, tmp_pid);
                     }
-
                     msg = remove_message(current_PCB, message_index);
+                    unlock_disk();
+
                     if (able_to_receive_length < msg->length) {
                         *SystemCallData->Argument[5] = ERR_BAD_PARAM;
                     }
@@ -630,83 +831,182 @@ void    svc( SYSTEM_CALL_DATA *SystemCallData ) {
             break;
 
         case SYSNUM_DISK_READ:
-            // make sure the disk number is valid
-            if (SystemCallData->Argument[0] < 1 || SystemCallData->Argument[0] > MAX_NUMBER_OF_DISKS) {
+            // make sure the disk number is valid; a volume counts as a disk
+            if (!block_device_exists((long) SystemCallData->Argument[0])) {
+                printf("Error, call to an invalid disk number\n");
+                break;
+            }
+
+            // make sure the sector is valid
+            if ((long) SystemCallData->Argument[1] < 0 ||
+                    (long) SystemCallData->Argument[1] >= block_device_sectors((long) SystemCallData->Argument[0])) {
+                printf("Error, call to an invalid sector requested\n");
+                break;
+            }
+
+            cached_disk_read(SystemCallData->Argument[0], SystemCallData->Argument[1], SystemCallData->Argument[2]);
+            break;
+
+        case SYSNUM_DISK_WRITE:
+            // make sure the disk number is valid; a volume counts as a disk
+            if (!block_device_exists((long) SystemCallData->Argument[0])) {
                 printf("Error, call to an invalid disk number\n");
                 break;
             }
 
             // make sure the sector is valid
-            if (SystemCallData->Argument[1] < 0 || SystemCallData->Argument[1] > NUM_LOGICAL_SECTORS) {
+            if ((long) SystemCallData->Argument[1] < 0 ||
+                    (long) SystemCallData->Argument[1] >= block_device_sectors((long) SystemCallData->Argument[0])) {
                 printf("Error, call to an invalid sector requested\n");
                 break;
             }
 
-            // allocate memory for the disk queue
-            if (disk_queue == NULL) {
-                disk_queue = (PCB**) calloc(sizeof(PCB*), MAX_NUMBER_OF_DISKS);
+            // call the wrapper function for handling disk writing
+            cached_disk_write(SystemCallData->Argument[0], SystemCallData->Argument[1], SystemCallData->Argument[2]);
+            break;
+        case SYSNUM_FLUSH_DISK:
+            // -1 means every disk
+            if ((long) SystemCallData->Argument[0] != -1 &&
+                    !block_device_exists((long) SystemCallData->Argument[0])) {
+                *SystemCallData->Argument[1] = ERR_BAD_PARAM;
+                break;
             }
 
-            // allocate the disk space on the current process
-            if(current_PCB->disk_data == NULL)
-                current_PCB->disk_data = calloc(sizeof(DISK*), 1);
+            // what gets written has to be on the platter before we return, not just
+            // in a disk's write cache
+            sync_writes += flush_buffers((long) SystemCallData->Argument[0], fsync_fua ? DISK_WRITE_FUA : DISK_WRITE);
+            flush_disk_caches((long) SystemCallData->Argument[0]);
+            *SystemCallData->Argument[1] = ERR_SUCCESS;
+            break;
 
-            // store the disk data on the process
-            current_PCB->disk_data->disk_id = SystemCallData->Argument[0];
-            current_PCB->disk_data->sector_id = SystemCallData->Argument[1];
-            current_PCB->disk_data->disk_operation = DISK_READ;
+        case SYSNUM_DISK_READ_ASYNC:
+        case SYSNUM_DISK_WRITE_ASYNC:
+            if (!block_device_exists((long) SystemCallData->Argument[0]) || (long) SystemCallData->Argument[1] < 0 ||
+                    (long) SystemCallData->Argument[1] >= block_device_sectors((long) SystemCallData->Argument[0])) {
+                *SystemCallData->Argument[5] = ERR_BAD_PARAM;
+                break;
+            }
 
-            disk_read(SystemCallData->Argument[0], SystemCallData->Argument[1], SystemCallData->Argument[2]);
+            *SystemCallData->Argument[4] = start_async_io((long) SystemCallData->Argument[0],
+                    (long) SystemCallData->Argument[1], (char*) SystemCallData->Argument[2],
+                    call_type == SYSNUM_DISK_READ_ASYNC ? DISK_READ : DISK_WRITE,
+                    (BOOL) (long) SystemCallData->Argument[3], &async_error);
+            *SystemCallData->Argument[5] = async_error;
+            break;
 
-            memcpy(SystemCallData->Argument[2], current_PCB->disk_data->buffer, PGSIZE);
-            memset(current_PCB->disk_data->buffer, '\0', PGSIZE);
+        case SYSNUM_DISK_WAIT:
+            if (wait_async_io((INT32) (long) SystemCallData->Argument[0]))
+                *SystemCallData->Argument[1] = ERR_SUCCESS;
+            else
+                *SystemCallData->Argument[1] = ERR_BAD_PARAM;
+            break;
 
+        case SYSNUM_DISK_WAIT_ANY:
+            *SystemCallData->Argument[0] = wait_any_async_io();
+            if (*SystemCallData->Argument[0] == -1)
+                *SystemCallData->Argument[1] = ERR_BAD_PARAM;   // nothing to wait for
+            else
+                *SystemCallData->Argument[1] = ERR_SUCCESS;
             break;
 
-        case SYSNUM_DISK_WRITE:
-            // make sure the disk number is valid
-            if (SystemCallData->Argument[0] < 1 || SystemCallData->Argument[0] > MAX_NUMBER_OF_DISKS) {
-                printf("Error, call to an invalid disk number\n");
+        case SYSNUM_DISK_POLL:
+            async_handle = (INT32) (long) SystemCallData->Argument[0];
+            if (async_handle < 0 || async_handle >= MAX_ASYNC_IO || current_PCB->async_io[async_handle] == NULL) {
+                *SystemCallData->Argument[2] = ERR_BAD_PARAM;
                 break;
             }
 
-            // make sure the sector is valid
-            if (SystemCallData->Argument[1] < 0 || SystemCallData->Argument[1] > NUM_LOGICAL_SECTORS) {
-                printf("Error, call to an invalid sector requested\n");
+            *SystemCallData->Argument[1] = current_PCB->async_io[async_handle]->done;
+            *SystemCallData->Argument[2] = ERR_SUCCESS;
+            break;
+
+        case SYSNUM_DISK_READV:
+        case SYSNUM_DISK_WRITEV:
+            segments = (DISK_SEGMENT*) SystemCallData->Argument[0];
+            segment_count = (INT32) (long) SystemCallData->Argument[1];
+            if (segment_count < 1 || segment_count > MAX_DISK_SEGMENTS) {
+                *SystemCallData->Argument[2] = ERR_BAD_PARAM;
                 break;
             }
 
-            // allocate the disk queue
-            if (disk_queue == NULL) {
-                disk_queue = (PCB**) calloc(sizeof(PCB*), MAX_NUMBER_OF_DISKS);
+            // every segment has to be good before any of them goes
+            for (i = 0; i < segment_count; i++) {
+                if (!block_device_exists(segments[i].disk_id) ||
+                        segments[i].sector_id < 0 || segments[i].sector_id >= block_device_sectors(segments[i].disk_id))
+                    break;
             }
+            if (i < segment_count) {
+                *SystemCallData->Argument[2] = ERR_BAD_PARAM;
+                break;
+            }
+
+            disk_transfer_vector(segments, segment_count,
+                                 call_type == SYSNUM_DISK_READV ? DISK_READ : DISK_WRITE);
+            vector_calls++;
+            vector_segments += segment_count;
+            *SystemCallData->Argument[2] = ERR_SUCCESS;
+            break;
 
-            // allocate the DISK data on the process
-            if(current_PCB->disk_data == NULL)
-                current_PCB->disk_data = calloc(sizeof(DISK*), 1);
-            memset(current_PCB->disk_data->buffer, '\0', PGSIZE);
+        case SYSNUM_DEFINE_SHARED_AREA:
+            break;
 
-            // store the disk data on the PCB
-            current_PCB->disk_data->disk_id = SystemCallData->Argument[0];
-            MEM_WRITE(Z502DiskSetID, &(current_PCB->disk_data->disk_id));
-            MEM_READ(Z502DiskStatus, &disk_status);
+        case SYSNUM_GET_PAGE_FAULTS:
+            tmp_pid = (INT32) (long) SystemCallData->Argument[0];
+            if (tmp_pid == -1)
+                tmp_pid = current_PCB->pid;
 
-            //sleep till free
-            while (!(disk_status == DEVICE_FREE)) {
-                sleep_process(20, current_PCB);
-                switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
-                MEM_WRITE(Z502DiskSetID, &(current_PCB->disk_data->disk_id));
-                MEM_READ(Z502DiskStatus, &disk_status);
+            if (find_process(tmp_pid) == NULL)
+                *SystemCallData->Argument[2] = ERR_BAD_PARAM;
+            else {
+                *SystemCallData->Argument[1] = get_process_stats(tmp_pid)->page_faults;
+                *SystemCallData->Argument[2] = ERR_SUCCESS;
             }
+            break;
 
-            // call the wrapper function for handling disk writing
-            disk_write(SystemCallData->Argument[0], SystemCallData->Argument[1], SystemCallData->Argument[2]);
+        case SYSNUM_GET_RESIDENT_SET:
+            tmp_pid = (INT32) (long) SystemCallData->Argument[0];
+            if (tmp_pid == -1)
+                tmp_pid = current_PCB->pid;
+
+            process_handle = find_process(tmp_pid);
+            if (process_handle == NULL)
+                *SystemCallData->Argument[2] = ERR_BAD_PARAM;
+            else {
+                *SystemCallData->Argument[1] = process_handle->resident_pages;
+                *SystemCallData->Argument[2] = ERR_SUCCESS;
+            }
             break;
-        case SYSNUM_DEFINE_SHARED_AREA:
+
+        case SYSNUM_SET_RESIDENT_LIMITS:
+            tmp_pid = (INT32) (long) SystemCallData->Argument[0];
+            if (tmp_pid == -1)
+                tmp_pid = current_PCB->pid;
+
+            process_handle = find_process(tmp_pid);
+            min_pages = (INT32) (long) SystemCallData->Argument[1];
+            max_pages = (INT32) (long) SystemCallData->Argument[2];
+
+            // everyone's minimums together have to leave a frame for the rest
+            reserved = 0;
+            for (process_node = process_list; process_node != NULL; process_node = process_node->next) {
+                if (process_node->data != NULL && process_node->data != process_handle)
+                    reserved += ((PCB*) process_node->data)->min_resident;
+            }
+
+            if (process_handle == NULL || min_pages < 0 || max_pages < 0 || (max_pages > 0 && max_pages < min_pages)
+                    || reserved + min_pages >= phys_mem_pgs)
+                *SystemCallData->Argument[3] = ERR_BAD_PARAM;
+            else {
+                process_handle->min_resident = min_pages;
+                process_handle->max_resident = max_pages;
+                *SystemCallData->Argument[3] = ERR_SUCCESS;
+            }
             break;
         default:
             printf("Unrecognized system call!!\n");
     }
+
+    preempt_if_needed();
 }                                               // End of svc
 
 /************************************************************************
@@ -722,8 +1022,40 @@ void    osInit( int argc, char *argv[]  ) {
     INT32 i;
 
     PCB* test_process;
-    timer_queue = create_list();
+    parse_os_options(argc, argv);
+    timer_queue = create_timer_wheel(0);
     process_list = create_list();
+    for (i = 1; i <= MAX_NUMBER_OF_DISKS; i++) {
+        disk_queue[i] = create_disk_queue();
+        disk_waiters[i] = create_wait_queue(WAITING_FOR_DISK);
+        if (disk_is_ssd(i)) {
+            // a solid state disk works on as many transfers at once as it has channels
+            INT32 disk_type = DISK_TYPE_SSD;
+            MEM_WRITE(Z502DiskSetID, &i);
+            MEM_WRITE(Z502DiskSetType, &disk_type);
+            disk_queue[i]->depth = SSD_CHANNELS;
+        }
+        else {
+            MEM_WRITE(Z502DiskSetID, &i);
+            MEM_WRITE(Z502DiskSetCachePolicy, &track_policy);
+            MEM_WRITE(Z502DiskSetCacheSize, &track_cache);
+            MEM_WRITE(Z502DiskSetWriteCache, &write_cache);
+        }
+    }
+    for (i = MAX_NUMBER_OF_DISKS + 1; i <= MAX_BLOCK_DEVICES; i++)
+        disk_waiters[i] = create_wait_queue(WAITING_FOR_DISK);
+    build_swap_volumes();
+    message_waiters = create_wait_queue(WAITING_FOR_MESSAGE);
+    page_waiters = create_wait_queue(WAITING_FOR_DISK);
+    pageout_io_waiters = create_wait_queue(WAITING_FOR_DISK);
+    pageout_idle_waiters = create_wait_queue(WAITING_FOR_FRAMES);
+    frame_waiters = create_wait_queue(WAITING_FOR_FRAMES);
+    buffer_waiters = create_wait_queue(WAITING_FOR_DISK);
+    flush_idle_waiters = create_wait_queue(WAITING_FOR_DISK);
+    async_waiters = create_wait_queue(WAITING_FOR_DISK);
+    vector_waiters = create_wait_queue(WAITING_FOR_DISK);
+    if (cache_buffers > 0)
+        buffer_cache = create_buffer_cache(cache_buffers);
 
     root_process_pcb = os_make_process("root", DEFAULT_PRIORITY, &error_response, (void*) dispatcher, KERNEL_MODE);
 
@@ -774,12 +1106,19 @@ PCB* os_make_process(char* name, INT32 priority, INT32* error, void* entry_point
         return NULL;
     }
 
-    if (get_length(process_list) >= MAX_PROCESSES) {
+    if (user_process_count() >= MAX_PROCESSES) {
         printf("Reached maximum number of processes\n");
         *error = ERR_BAD_PARAM;
         return NULL;
     }
 
+    // every process gets a thread of its own from the simulator, and they are never handed back
+    if (gen_pid > MAX_NUMBER_OF_USER_THREADS) {
+        printf("Out of threads for new processes\n");
+        *error = ERR_BAD_PARAM;
+        return NULL;
+    }
+
     PCB* process_handle = search_for_name(process_list, name);
     if (process_handle != NULL) {
         *error = ERR_BAD_PARAM;
@@ -797,8 +1136,24 @@ PCB* os_make_process(char* name, INT32 priority, INT32* error, void* entry_point
     pcb->pid = gen_pid;                             // assign pid
     gen_pid++;
     pcb->state=CREATE;
+    pcb->priority = priority;
     pcb->time_spent_processing = 0;
-    memset(pcb->pagetable, 0, VIRTUAL_MEM_PGS+1);   // assign pagetable
+    pcb->last_dispatched = 0;
+    pcb->donor_pid = -1;
+    pcb->resident_pages = 0;
+    pcb->min_resident = 0;
+    pcb->max_resident = 0;
+    pcb->last_fault_page = -1;
+    pcb->fault_stride = 0;
+    pcb->stream_length = 0;
+    pcb->readahead_next = -1;
+    pcb->readahead_window = READAHEAD_START;
+    pcb->prefetch_pending = 0;
+    pcb->wait_queue = NULL;                         // not blocked on anything yet
+    pcb->wait_next = NULL;
+    memset(pcb->pagetable, 0, sizeof(pcb->pagetable));  // assign pagetable
+    pcb->shadow_table = NULL;                       // nothing has been paged out yet
+    memset(pcb->async_io, 0, sizeof(pcb->async_io));    // no transfers going on its behalf
 
     memset(pcb->name, 0, MAX_NAME);                 // assign process name
     strcpy(pcb->name, name);                        // assign process name
@@ -812,10 +1167,17 @@ PCB* os_make_process(char* name, INT32 priority, INT32* error, void* entry_point
 
     (*error) = ERR_SUCCESS;                         // return error value
 
-    if (pcb->parent != -1)                          // Add everything except the root process to the process_list
+    if (pcb->parent != -1) {                        // Add everything except the root process to the process_list
         add_to_list(process_list, pcb);
+        scheduler_admit(process_list, pcb);
+    }
 
     Z502MakeContext(&pcb->context, entry_point, mode );
+    Z502SetPageTable(&pcb->context, pcb->pagetable, VIRTUAL_MEM_PGS);
+
+    PROCESS_STATS* stats = get_process_stats(pcb->pid);
+    if (stats != NULL)
+        strcpy(stats->name, pcb->name);
 
     return pcb;
 }
@@ -829,12 +1191,44 @@ void os_destroy_process(PCB* pcb) {
     }
 
     //scheduler_printer("TERMINATED");
-    remove_from_list(timer_queue, pcb->pid);
-
+    lock_timer();
+    timer_wheel_remove(timer_queue, pcb);
+    unlock_timer();
+
+    // the disk lock guards the disk wait queues, and nothing else can be waited on while we hold it
+    lock_disk();
+    wait_queue_remove(pcb->wait_queue, pcb);
+    unlock_disk();
+
+    abandon_async_io(pcb);
+    release_frames(pcb);
+    release_swap(pcb);
     Z502DestroyContext(&pcb->context);
     free(pcb);
 }
 
+/**
+* How many processes there are, not counting the root or the OS's daemons
+*/
+INT32 user_process_count(void) {
+    INT32 count = get_length(process_list);
+
+    if (pageout_pcb != NULL)
+        count--;
+    if (flush_pcb != NULL)
+        count--;
+    return count;
+}
+
+/**
+* Look up any process by pid, the root process included
+*/
+PCB* find_process(INT32 pid) {
+    if (root_process_pcb != NULL && root_process_pcb->pid == pid)
+        return root_process_pcb;
+    return search_for_pid(process_list, pid);
+}
+
 /**
  *  This function is responsible for removing processes
  *  from the ready queue and switching to their context
@@ -871,41 +1265,32 @@ void dispatcher() {
                 cursor = cursor->next;
         }
 
-        if (add_next_to_timer) {
-            add_next_to_timer = FALSE;
-
-            if (get_length(timer_queue) > 0) {
-                INT32 current_time;
-                MEM_READ(Z502ClockStatus, &current_time);
-                INT32 sleep_time = timer_queue->data->delay - current_time;
-                if (sleep_time < 0)
-                    sleep_time = 0;
-                MEM_WRITE(Z502TimerStart, &(sleep_time));
-            }
-        }
-
-        if (get_length(process_list) == 0) {        //If no active processes then halt
+        if (user_process_count() == 0) {            //If no active processes then halt
             //printf("No processes exist other than root, halting\n");
-            Z502Halt();
+            os_halt();
         }
 
         if (root_process_pcb->state == TERMINATE) {
             //printf("Root processed killed.  halting\n");
-            Z502Halt();
+            os_halt();
         }
 
-        LinkedList ready_queue;            // Holds all processes that are currently waiting to be run
-        ready_queue = build_ready_queue(process_list);
+        INT32 current_time;
+        MEM_READ(Z502ClockStatus, &current_time);
 
-        if(ready_queue->data != NULL) {
-            PCB* process_to_run = ready_queue->data;
-            process_to_run->state = RUNNING;
-            free_ready_queue(ready_queue);
+        // let the scheduling policy decide who goes next
+        PCB* process_to_run = scheduler->pick_next(process_list, current_time);
 
+        if(process_to_run != NULL) {
+            process_to_run->state = RUNNING;
             switch_context(process_to_run, SWITCH_CONTEXT_SAVE_MODE);
         }
+        else if (timer_armed_deadline != -1 && timer_armed_deadline <= current_time) {
+            // the timer has already gone off and its interrupt is on the way.  Idling
+            // now would find nothing left on the event queue, so go round again instead
+            continue;
+        }
         else {
-            free_ready_queue(ready_queue);
             CALL( Z502Idle() );
         }
     }
@@ -918,20 +1303,59 @@ void dispatcher() {
 **********************************************************/
 void switch_context( PCB* pcb, short context_mode) {
     INT32 current_time;
+    PROCESS_STATS* stats;
     MEM_READ(Z502ClockStatus, &current_time);
 
     if (current_PCB != NULL) {
-        if (current_PCB->state == RUNNING) {
-            current_PCB->time_spent_processing += (current_time - last_context_switch);
+        // the process ran up until now, whether it is leaving to sleep, wait or be preempted
+        current_PCB->time_spent_processing += (current_time - last_context_switch);
+        stats = get_process_stats(current_PCB->pid);
+        if (stats != NULL)
+            stats->cpu_time += (current_time - last_context_switch);
+
+        // anything still RUNNING at this point is being preempted
+        if (current_PCB != root_process_pcb)
+            scheduler->descheduled(current_PCB, current_time - last_context_switch, current_PCB->state == RUNNING);
+
+        if (current_PCB->state == RUNNING)
             current_PCB->state = READY;
-        }
     }
 
 	current_PCB = pcb;
     pcb->state = RUNNING;      //update the PCB state to RUN
     last_context_switch = current_time;
 
+    if (pcb != root_process_pcb) {
+        dispatch_count++;
+        // only time slicing rotates a priority level; without it the
+        // ready queue keeps the order the OS has always given it
+        if (time_quantum > 0)
+            pcb->last_dispatched = dispatch_count;
+        stats = get_process_stats(pcb->pid);
+        if (stats != NULL)
+            stats->switches++;
+    }
+
+    hardware_switches++;
+
+    // hand out a fresh time slice; the root process is never preempted
+    lock_timer();
+    preempt_pending = FALSE;
+    if (pcb != root_process_pcb && time_quantum > 0 && donated_slice > 0)
+        slice_deadline = current_time + donated_slice;
+    else if (pcb != root_process_pcb && time_quantum > 0)
+        slice_deadline = current_time + scheduler->quantum(pcb, time_quantum);
+    else
+        slice_deadline = -1;
+    donated_slice = -1;
+    reset_timer();
+    unlock_timer();
+
     Z502SwitchContext( context_mode, &(pcb->context));
+
+    // Switching loads the mode of whoever we switched to.  Now that we are
+    // running again we're still inside the OS, so put kernel mode back.
+    Z502_MODE = KERNEL_MODE;
 }
 
 /**
@@ -962,146 +1386,616 @@ void sleep_process(INT32 sleep_time, PCB* sleeping_process) {
     MEM_READ(Z502ClockStatus, &current_time);
     INT32 wait_time = current_time + sleep_time;
     sleeping_process->delay = wait_time;
-    add_to_list(timer_queue, sleeping_process);
+
+    // mark it first so a timer interrupt can't wake it before it is asleep
     sleeping_process->state = SLEEPING;
 
-    INT32 ticks_till_wake = timer_queue->data->delay - current_time;
-    if (ticks_till_wake < 0)       //TODO I should validate this or throw an error if it is ever < 0
+    lock_timer();
+    timer_wheel_insert(timer_queue, sleeping_process, current_time);
+    reset_timer();
+    unlock_timer();
+}
+
+/**
+* Points the hardware timer at whichever comes first, the earliest deadline
+* on the timer wheel or the end of the running process's time slice.
+* The timer is only touched when that deadline is different from the one it
+* is already counting down to.  The caller must hold the timer lock.
+*/
+void reset_timer(void) {
+    INT32 current_time;
+    INT32 next_deadline;
+    INT32 ticks_till_wake;
+
+    next_deadline = timer_wheel_next_deadline(timer_queue);
+    if (slice_deadline != -1 && (next_deadline == -1 || slice_deadline < next_deadline))
+        next_deadline = slice_deadline;
+
+    if (next_deadline == -1 || next_deadline == timer_armed_deadline)
+        return;
+
+    MEM_READ(Z502ClockStatus, &current_time);
+    ticks_till_wake = next_deadline - current_time;
+    if (ticks_till_wake < 0)
         ticks_till_wake = 0;
 
-    MEM_WRITE(Z502TimerStart, &timer_queue->data->delay);
+    timer_armed_deadline = next_deadline;
+    MEM_WRITE(Z502TimerStart, &ticks_till_wake);
 }
 
 /**
-* This function is just a cleaner way to handle the various
-* function calls from the command line arguments. It makes the
-* above functions a little easier to read.
+* Called when the current process has to wait (sleep, disk, message) and has
+* already been marked that way.  Rather than bouncing through the root
+* process, which would just pick the next process and switch again, ask the
+* scheduler here and switch straight to whoever is next.  The root only runs
+* when there is nobody to run, or to clean up after a terminated process.
 */
-func_ptr get_function_handle(char *name) {
-    //printf("looking for function handle with name: %s\n", name);
-    func_ptr response;
-    if (strcmp( name, "sample" ) == 0 )
-        response = (void*) sample_code;
-    else if ( strcmp( name, "test0" ) == 0 )
-        response = (void*) test0;
-    else if ( strcmp( name, "test1a" ) == 0 )
-        response = (void*) test1a;
-    else if ( strcmp( name, "test1b" ) == 0 )
-        response = (void*) test1b;
-    else if ( strcmp( name, "test1c" ) == 0 )
-        response = (void*) test1c;
-    else if ( strcmp( name, "test1d" ) == 0 )
-        response = (void*) test1d;
-    else if ( strcmp( name, "test1e" ) == 0 )
-        response = (void*) test1e;
-    else if ( strcmp( name, "test1f" ) == 0 )
-        response = (void*) test1f;
-    else if ( strcmp( name, "test1g" ) == 0 )
-        response = (void*) test1g;
-    else if ( strcmp( name, "test1h" ) == 0 )
-        response = (void*) test1h;
-    else if ( strcmp( name, "test1i" ) == 0 )
-        response = (void*) test1i;
-    else if ( strcmp( name, "test1j" ) == 0 )
-        response = (void*) test1j;
-    else if ( strcmp( name, "test1k" ) == 0 )
-        response = (void*) test1k;
-    else if ( strcmp( name, "test1l" ) == 0 )
-        response = (void*) test1l;
-    else if ( strcmp( name, "test1m" ) == 0 )
-        response = (void*) test1m;
-    else if ( strcmp( name, "test2a" ) == 0 ) {
-        response = (void*) test2a;
-        print_memory = 1;
-        print_schedule = 0;
-    }
-    else if ( strcmp( name, "test2b" ) == 0 ) {
-        response = (void*) test2b;
-        print_memory = 1;
-        print_schedule = 0;
-    }
-    else if ( strcmp( name, "test2c" ) == 0 ) {
-        response = (void*) test2c;
-        print_schedule = 1;
-        print_memory = 0;
-    }
-    else if ( strcmp( name, "test2d" ) == 0 ) {
-        response = (void*) test2d;
-        print_schedule = 1;
-        print_memory = 0;
-    }
-    else if ( strcmp( name, "test2e" ) == 0 ) {
-        response = (void*) test2e;
-        print_memory = 1;
-        print_schedule = 1;
+void give_up_cpu(void) {
+    INT32 current_time;
+    PCB* next_process = NULL;
+
+    blocking_operations++;
+
+    // if we were running on time a message sender gave us, hand what is left back to it
+    if (current_PCB->donor_pid != -1) {
+        PCB* donor = search_for_pid(process_list, current_PCB->donor_pid);
+        current_PCB->donor_pid = -1;
+
+        if (directed_yield && donor != NULL && donor->state == READY) {
+            donate_slice(donor);
+            return;
+        }
     }
-    else if ( strcmp( name, "test2f" ) == 0 ) {
-        response = (void*) test2f;
-        print_schedule = 0;
-        print_memory = 1;
+
+    if (direct_handoff) {
+        MEM_READ(Z502ClockStatus, &current_time);
+        next_process = scheduler->pick_next(process_list, current_time);
     }
-    else if ( strcmp( name, "test2g" ) == 0 ) {
-        response = (void*) test2g;
-        print_memory = 0;
-        print_schedule = 0;
+
+    // whatever we were waiting for has already happened, so keep going
+    if (next_process != NULL && next_process == current_PCB) {
+        current_PCB->state = RUNNING;
+        return;
     }
-    else if ( strcmp( name, "test2h" ) == 0 )
-        response = (void*) test2h;
-    else if ( strcmp( name, "test2cAlt") == 0)
-        response = (void*) test2cAlt;
-    else
-        response = NULL;
-    return response;
+
+    if (next_process == NULL)
+        next_process = root_process_pcb;
+
+    switch_context(next_process, SWITCH_CONTEXT_SAVE_MODE);
 }
 
 /**
-* Print out the state of the processes whenever it is called.
-* This is basically a glorified wrapper for all these state_printer calls
+* Directed yield: switch straight to target, which should already be READY,
+* and let it finish out the rest of our time slice.  We go back on the ready
+* queue as though we had given up the CPU on our own, and get the CPU back
+* as soon as target blocks again.
 */
-void scheduler_printer(char* action) {
-    int time;
-    PCB* p;
-
-    // this makes sure we don't print out state information
-    // all the time if it is not needed
-    if(print_schedule == 1) {
-        MEM_READ(Z502ClockStatus, &time);
-        SP_setup(SP_TIME_MODE, time);
+void yield_to(PCB* target) {
+    directed_yields++;
+    target->donor_pid = current_PCB->pid;
+    current_PCB->state = READY;
+    donate_slice(target);
+}
 
-        SP_setup_action(SP_ACTION_MODE, action);
+/**
+* Switch to target and let it run out whatever is left of the current slice
+*/
+void donate_slice(PCB* target) {
+    INT32 current_time;
 
-        if(current_PCB != NULL) {
-            SP_setup(SP_TARGET_MODE, current_PCB->pid);
-            SP_setup( SP_RUNNING_MODE, current_PCB->pid );
-        }
+    MEM_READ(Z502ClockStatus, &current_time);
 
-        SP_print_header();
-        SP_print_line();
+    if (slice_deadline != -1) {
+        donated_slice = slice_deadline - current_time;
+        if (donated_slice < 1)
+            donated_slice = 1;
     }
+
+    switch_context(target, SWITCH_CONTEXT_SAVE_MODE);
 }
 
 /**
-* Prints out the current state of everything in memory
-* both virtual and physical
+* If the timer interrupt said the running process's slice is up, put it back
+* on the ready queue and let the dispatcher pick who goes next.  This is called
+* on the way out of the OS, since that is the only place we can switch safely.
+*/
+void preempt_if_needed(void) {
+    PROCESS_STATS* stats;
+
+    if (!preempt_pending || current_PCB == NULL || current_PCB == root_process_pcb)
+        return;
+
+    preempt_pending = FALSE;
+    current_PCB->donor_pid = -1;        // any time it was given is used up too
+
+    // it might already be on its way to sleep or waiting on something
+    if (current_PCB->state != RUNNING)
+        return;
+
+    stats = get_process_stats(current_PCB->pid);
+    if (stats != NULL)
+        stats->preemptions++;
+
+    scheduler_printer("PREEMPT");
+    switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
+}
+
+/**
+* Returns the statistics record for a pid, growing the table if this is
+* the first time we have seen it.
+*/
+PROCESS_STATS* get_process_stats(INT32 pid) {
+    INT32 i;
+
+    if (pid < 0)
+        return NULL;
+
+    if (pid >= process_stats_length) {
+        INT32 new_length = pid + MAX_PROCESSES;
+        PROCESS_STATS* grown = (PROCESS_STATS*) realloc(process_stats, new_length * sizeof(PROCESS_STATS));
+        if (grown == NULL)
+            return NULL;
+
+        for (i = process_stats_length; i < new_length; i++) {
+            memset(&grown[i], 0, sizeof(PROCESS_STATS));
+            grown[i].pid = -1;
+        }
+
+        process_stats = grown;
+        process_stats_length = new_length;
+    }
+
+    process_stats[pid].pid = pid;
+    return &process_stats[pid];
+}
+
+/**
+* Reads the OS options that follow the test name on the command line.
+* Each one looks like -name=value, e.g. "Z502.exe test1c -quantum=50 -sched=mlfq"
+*/
+void parse_os_options(int argc, char* argv[]) {
+    int i;
+
+    scheduler = find_scheduler_policy("priority");
+    pager = find_pager_policy("clock");
+    disk_policy = find_disk_policy(DEFAULT_DISK_POLICY);
+
+    for (i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "-quantum=", 9) == 0) {
+            time_quantum = atoi(argv[i] + 9);
+            if (time_quantum < 0)
+                time_quantum = 0;
+        }
+        else if (strncmp(argv[i], "-handoff=", 9) == 0)
+            direct_handoff = (atoi(argv[i] + 9) != 0);
+        else if (strncmp(argv[i], "-directed_yield=", 16) == 0)
+            directed_yield = (atoi(argv[i] + 16) != 0);
+        else if (strncmp(argv[i], "-frames=", 8) == 0) {
+            phys_mem_pgs = atoi(argv[i] + 8);
+            if (phys_mem_pgs < 1 || phys_mem_pgs > MAX_PHYS_MEM_PGS) {
+                printf("Frames must be between 1 and %d, using %d\n", MAX_PHYS_MEM_PGS, PHYS_MEM_PGS);
+                phys_mem_pgs = PHYS_MEM_PGS;
+            }
+        }
+        else if (strncmp(argv[i], "-pager=", 7) == 0) {
+            if (find_pager_policy(argv[i] + 7) != NULL)
+                pager = find_pager_policy(argv[i] + 7);
+            else
+                printf("Unknown replacement policy %s, using %s\n", argv[i] + 7, pager->name);
+        }
+        else if (strncmp(argv[i], "-pageout=", 9) == 0)
+            pageout_enabled = (atoi(argv[i] + 9) != 0);
+        else if (strncmp(argv[i], "-zero_page=", 11) == 0)
+            zero_page_enabled = (atoi(argv[i] + 11) != 0);
+        else if (strncmp(argv[i], "-readahead=", 11) == 0) {
+            readahead_max = atoi(argv[i] + 11);
+            if (readahead_max < 0)
+                readahead_max = 0;
+        }
+        else if (strncmp(argv[i], "-swap_disks=", 12) == 0) {
+            swap_disks = atoi(argv[i] + 12);
+            if (swap_disks < 1 || swap_disks > MAX_NUMBER_OF_DISKS) {
+                printf("Swap disks must be between 1 and %d, using %d\n", MAX_NUMBER_OF_DISKS, DEFAULT_SWAP_DISKS);
+                swap_disks = DEFAULT_SWAP_DISKS;
+            }
+        }
+        else if (strncmp(argv[i], "-ws_window=", 11) == 0) {
+            ws_window = atol(argv[i] + 11);
+            if (ws_window < 0)
+                ws_window = 0;
+        }
+        else if (strncmp(argv[i], "-cache_buffers=", 15) == 0) {
+            cache_buffers = atoi(argv[i] + 15);
+            if (cache_buffers < 0)
+                cache_buffers = 0;
+        }
+        else if (strncmp(argv[i], "-flush_interval=", 16) == 0) {
+            flush_interval = atoi(argv[i] + 16);
+            if (flush_interval < 1)
+                flush_interval = 1;
+        }
+        else if (strncmp(argv[i], "-ssd_disks=", 11) == 0) {
+            ssd_disks = atoi(argv[i] + 11);
+            if (ssd_disks < 0 || ssd_disks > MAX_NUMBER_OF_DISKS) {
+                printf("SSD disks must be between 0 and %d, using %d\n", MAX_NUMBER_OF_DISKS, DEFAULT_SSD_DISKS);
+                ssd_disks = DEFAULT_SSD_DISKS;
+            }
+        }
+        else if (strncmp(argv[i], "-track_cache=", 13) == 0) {
+            track_cache = atoi(argv[i] + 13);
+            if (track_cache < 0 || track_cache > NUM_LOGICAL_SECTORS) {
+                printf("Track cache must be between 0 and %d sectors, using %d\n", NUM_LOGICAL_SECTORS, DEFAULT_TRACK_CACHE);
+                track_cache = DEFAULT_TRACK_CACHE;
+            }
+        }
+        else if (strncmp(argv[i], "-write_cache=", 13) == 0) {
+            write_cache = atoi(argv[i] + 13);
+            if (write_cache < 0 || write_cache > WRITE_CACHE_MAX) {
+                printf("Write cache must be between 0 and %d sectors, using %d\n", WRITE_CACHE_MAX, DEFAULT_WRITE_CACHE);
+                write_cache = DEFAULT_WRITE_CACHE;
+            }
+        }
+        else if (strncmp(argv[i], "-fsync=", 7) == 0) {
+            if (strcmp(argv[i] + 7, "flush") == 0)
+                fsync_fua = FALSE;
+            else if (strcmp(argv[i] + 7, "fua") == 0)
+                fsync_fua = TRUE;
+            else
+                printf("Unknown fsync method %s, using %s\n", argv[i] + 7, fsync_fua ? "fua" : "flush");
+        }
+        else if (strncmp(argv[i], "-track_policy=", 14) == 0) {
+            if (strcmp(argv[i] + 14, "ahead") == 0)
+                track_policy = DISK_CACHE_AHEAD;
+            else if (strcmp(argv[i] + 14, "track") == 0)
+                track_policy = DISK_CACHE_TRACK;
+            else
+                printf("Unknown track cache policy %s, using %s\n", argv[i] + 14,
+                       track_policy == DISK_CACHE_TRACK ? "track" : "ahead");
+        }
+        else if (strncmp(argv[i], "-stripe=", 8) == 0) {
+            stripe_sectors = atoi(argv[i] + 8);
+            if (stripe_sectors < 1 || stripe_sectors > NUM_LOGICAL_SECTORS) {
+                printf("Stripe must be between 1 and %d sectors, using %d\n", NUM_LOGICAL_SECTORS, DEFAULT_STRIPE);
+                stripe_sectors = DEFAULT_STRIPE;
+            }
+        }
+        else if (strncmp(argv[i], "-mirror_read=", 13) == 0) {
+            if (strcmp(argv[i] + 13, "busy") == 0)
+                mirror_policy = MIRROR_LEAST_BUSY;
+            else if (strcmp(argv[i] + 13, "near") == 0)
+                mirror_policy = MIRROR_NEAREST_HEAD;
+            else
+                printf("Unknown mirror read policy %s, using %s\n", argv[i] + 13,
+                       mirror_policy == MIRROR_NEAREST_HEAD ? "near" : "busy");
+        }
+        else if (strncmp(argv[i], "-swap_volume=", 13) == 0) {
+            if (strcmp(argv[i] + 13, "raid0") == 0)
+                swap_volume = VOLUME_RAID0;
+            else if (strcmp(argv[i] + 13, "raid1") == 0)
+                swap_volume = VOLUME_RAID1;
+            else if (strcmp(argv[i] + 13, "none") == 0)
+                swap_volume = -1;
+            else
+                printf("Unknown swap volume %s, swapping straight to the disks\n", argv[i] + 13);
+        }
+        else if (strncmp(argv[i], "-volume=", 8) == 0)
+            continue;       // set up below, once -stripe= is in wherever it was
+        else if (strncmp(argv[i], "-disk_sched=", 12) == 0) {
+            if (find_disk_policy(argv[i] + 12) != NULL)
+                disk_policy = find_disk_policy(argv[i] + 12);
+            else
+                printf("Unknown disk scheduling policy %s, using %s\n", argv[i] + 12, disk_policy->name);
+        }
+        else if (strncmp(argv[i], "-sched=", 7) == 0) {
+            if (find_scheduler_policy(argv[i] + 7) != NULL)
+                scheduler = find_scheduler_policy(argv[i] + 7);
+            else
+                printf("Unknown scheduling policy %s, using %s\n", argv[i] + 7, scheduler->name);
+        }
+        else
+            printf("Unrecognized OS option: %s\n", argv[i]);
+    }
+
+    // the feedback queue only moves a process down when its slice runs out
+    if (strcmp(scheduler->name, "mlfq") == 0 && time_quantum == 0) {
+        printf("MLFQ needs time slices, using -quantum=%d\n", MLFQ_DEFAULT_QUANTUM);
+        time_quantum = MLFQ_DEFAULT_QUANTUM;
+    }
+
+    for (i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "-volume=", 8) == 0)
+            parse_volume(argv[i] + 8);
+    }
+}
+
+/**
+* Prints out how the CPU was shared between the processes and then
+* shuts the machine down
+*/
+void os_halt(void) {
+    INT32 current_time;
+    INT32 i;
+    INT32 j;
+    long total_switches = 0;
+    long seek_distance = 0;
+
+    MEM_READ(Z502ClockStatus, &current_time);
+
+    printf("\nScheduler statistics at time %d (policy %s, quantum %d)\n", current_time, scheduler->name, time_quantum);
+    printf("  PID  Name              CPU   Share  Switches  Preempted\n");
+    for (i = 0; i < process_stats_length; i++) {
+        if (process_stats[i].pid == -1)
+            continue;
+
+        printf("  %3d  %-16s %5ld  %5.1f%%  %8d  %9d\n",
+               process_stats[i].pid, process_stats[i].name, process_stats[i].cpu_time,
+               current_time > 0 ? (100.0 * process_stats[i].cpu_time) / current_time : 0.0,
+               process_stats[i].switches, process_stats[i].preemptions);
+        total_switches += process_stats[i].switches;
+    }
+    printf("  Total context switches: %ld\n", total_switches);
+    printf("  Hardware context switches: %ld, blocking operations: %ld", hardware_switches, blocking_operations);
+    if (blocking_operations > 0)
+        printf(" (%.2f switches per block)", (double) hardware_switches / blocking_operations);
+    printf("\n  Direct handoff: %s, directed yields: %ld\n", direct_handoff ? "on" : "off", directed_yields);
+    printf("  Free frames: %d of %d\n", frame_list != NULL ? frame_bitmap_free_count(free_frames) : phys_mem_pgs, phys_mem_pgs);
+    printf("  Page faults: %ld, replacements: %ld (%ld dirty), policy %s\n",
+           page_faults, page_replacements, dirty_replacements, pager->name);
+    printf("  Swap ins: %ld, swap sectors in use: %d of %d, striped over %d devices from %d\n", swap_ins,
+           swap_slot_count(swap_area) - swap_free_count(swap_area), swap_slot_count(swap_area),
+           swap_devices, swap_first_disk);
+    printf("  Fault service time: average %ld, worst %ld\n", page_faults > 0 ? fault_time_total / page_faults : 0,
+           fault_time_worst);
+    printf("  Page-out daemon: %s, freed %ld frames (%ld written out)\n", pageout_enabled ? "on" : "off",
+           pageout_frames, pageout_writes);
+    printf("  Zero page: %ld first touches, copy on write: %ld pages shared, %ld write faults, %ld copies\n",
+           zero_fills, pages_shared, write_faults, cow_copies);
+    printf("  Read ahead: %ld pages, %ld used", prefetches, prefetch_hits);
+    if (prefetch_hits + prefetch_waste > 0)
+        printf(" (%.0f%% hit rate)", 100.0 * prefetch_hits / (prefetch_hits + prefetch_waste));
+    printf(", %ld evicted unused\n", prefetch_waste);
+    for (i = 1; i <= MAX_NUMBER_OF_DISKS; i++)
+        seek_distance += disk_queue[i]->seek_distance;
+    printf("  Disk transfers: %ld, policy %s, wait average %ld, worst %ld, seek average %ld sectors\n",
+           disk_requests, disk_policy->name, disk_requests > 0 ? disk_wait_total / disk_requests : 0,
+           disk_wait_worst, disk_requests > 0 ? seek_distance / disk_requests : 0);
+    printf("  Buffer cache: %d buffers, %ld hits of %ld reads", buffer_cache != NULL ? cache_buffers : 0,
+           cache_hits, cache_hits + cache_misses);
+    if (cache_hits + cache_misses > 0)
+        printf(" (%.0f%% hit rate)", 100.0 * cache_hits / (cache_hits + cache_misses));
+    printf(", %ld written back, %d dirty\n", cache_writebacks, buffer_cache_dirty_count(buffer_cache));
+    printf("  Disk writes: %ld, %ld merged, flushed %ld (%ld for FLUSH_DISK), stall average %ld\n",
+           disk_write_calls, writes_merged, flush_writes + sync_writes, sync_writes,
+           disk_write_calls > 0 ? write_stall_total / disk_write_calls : 0);
+    printf("  Async transfers: %ld, %ld answered from the cache, %ld reported by message\n",
+           async_requests, async_cache_hits, async_messages);
+    printf("  Vectored transfers: %ld calls, %ld sectors, %ld answered from the cache\n",
+           vector_calls, vector_segments, vector_cache_hits);
+    printf("  Solid state disks: %d, %ld sectors trimmed\n", ssd_disks, disk_trims);
+    printf("  Track cache: %d sectors a disk, policy %s\n", track_cache,
+           track_policy == DISK_CACHE_TRACK ? "track" : "ahead");
+    printf("  Write cache: %d sectors a disk, %ld flushes, %ld FUA writes, FLUSH_DISK by %s\n", write_cache,
+           cache_flushes, fua_writes, fsync_fua ? "fua" : "flush");
+    for (i = 0; i < volume_count; i++) {
+        printf("  Volume %d: RAID-%d over disks %d-%d", volumes[i]->volume_id,
+               volumes[i]->type == VOLUME_RAID1 ? 1 : 0, volumes[i]->first_disk,
+               volumes[i]->first_disk + volumes[i]->member_count - 1);
+        if (volumes[i]->type == VOLUME_RAID0)
+            printf(", stripe %d sectors", volumes[i]->stripe_sectors);
+        printf(", %ld reads, %ld writes", volumes[i]->reads, volumes[i]->writes);
+        if (volumes[i]->type == VOLUME_RAID1) {
+            printf(", reads by member");
+            for (j = 0; j < volumes[i]->member_count; j++)
+                printf(" %ld", volumes[i]->member_reads[j]);
+            printf(" (%s)", mirror_policy == MIRROR_NEAREST_HEAD ? "near" : "busy");
+        }
+        printf("%s\n", volumes[i]->volume_id >= swap_first_disk
+                        && volumes[i]->volume_id < swap_first_disk + swap_devices ? ", swap" : "");
+    }
+    printf("\n");
+
+    Z502Halt();
+}
+
+/**
+* The timer wheel is shared by the interrupt thread and whichever
+* process is sleeping, so guard it with a hardware interlock
+*/
+void lock_timer(void) {
+    INT32 lock_result;
+    READ_MODIFY(TIMER_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &lock_result);
+}
+
+void unlock_timer(void) {
+    INT32 lock_result;
+    READ_MODIFY(TIMER_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &lock_result);
+}
+
+void lock_disk(void) {
+    INT32 lock_result;
+    READ_MODIFY(DISK_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &lock_result);
+}
+
+void unlock_disk(void) {
+    INT32 lock_result;
+    READ_MODIFY(DISK_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &lock_result);
+}
+
+/**
+* This function is just a cleaner way to handle the various
+* function calls from the command line arguments. It makes the
+* above functions a little easier to read.
+*/
+func_ptr get_function_handle(char *name) {
+    //printf("looking for function handle with name: %s\n", name);
+    func_ptr response;
+    if (strcmp( name, "sample" ) == 0 )
+        response = (void*) sample_code;
+    else if ( strcmp( name, "test0" ) == 0 )
+        response = (void*) test0;
+    else if ( strcmp( name, "test1a" ) == 0 )
+        response = (void*) test1a;
+    else if ( strcmp( name, "test1b" ) == 0 )
+        response = (void*) test1b;
+    else if ( strcmp( name, "test1c" ) == 0 )
+        response = (void*) test1c;
+    else if ( strcmp( name, "test1d" ) == 0 )
+        response = (void*) test1d;
+    else if ( strcmp( name, "test1e" ) == 0 )
+        response = (void*) test1e;
+    else if ( strcmp( name, "test1f" ) == 0 )
+        response = (void*) test1f;
+    else if ( strcmp( name, "test1g" ) == 0 )
+        response = (void*) test1g;
+    else if ( strcmp( name, "test1h" ) == 0 )
+        response = (void*) test1h;
+    else if ( strcmp( name, "test1i" ) == 0 )
+        response = (void*) test1i;
+    else if ( strcmp( name, "test1j" ) == 0 )
+        response = (void*) test1j;
+    else if ( strcmp( name, "test1k" ) == 0 )
+        response = (void*) test1k;
+    else if ( strcmp( name, "test1l" ) == 0 )
+        response = (void*) test1l;
+    else if ( strcmp( name, "test1m" ) == 0 )
+        response = (void*) test1m;
+    else if ( strcmp( name, "test2a" ) == 0 ) {
+        response = (void*) test2a;
+        print_memory = 1;
+        print_schedule = 0;
+    }
+    else if ( strcmp( name, "test2b" ) == 0 ) {
+        response = (void*) test2b;
+        print_memory = 1;
+        print_schedule = 0;
+    }
+    else if ( strcmp( name, "test2c" ) == 0 ) {
+        response = (void*) test2c;
+        print_schedule = 1;
+        print_memory = 0;
+    }
+    else if ( strcmp( name, "test2d" ) == 0 ) {
+        response = (void*) test2d;
+        print_schedule = 1;
+        print_memory = 0;
+    }
+    else if ( strcmp( name, "test2e" ) == 0 ) {
+        response = (void*) test2e;
+        print_memory = 1;
+        print_schedule = 1;
+    }
+    else if ( strcmp( name, "test2f" ) == 0 ) {
+        response = (void*) test2f;
+        print_schedule = 0;
+        print_memory = 1;
+    }
+    else if ( strcmp( name, "test2g" ) == 0 ) {
+        response = (void*) test2g;
+        print_memory = 0;
+        print_schedule = 0;
+    }
+    else if ( strcmp( name, "test2h" ) == 0 )
+        response = (void*) test2h;
+    else if ( strcmp( name, "test2cAlt") == 0)
+        response = (void*) test2cAlt;
+    else if ( strcmp( name, "test3a" ) == 0 )
+        response = (void*) test3a;
+    else if ( strcmp( name, "test3b" ) == 0 )
+        response = (void*) test3b;
+    else if ( strcmp( name, "test3c" ) == 0 )
+        response = (void*) test3c;
+    else if ( strcmp( name, "test3d" ) == 0 )
+        response = (void*) test3d;
+    else if ( strcmp( name, "test3e" ) == 0 )
+        response = (void*) test3e;
+    else if ( strcmp( name, "test3f" ) == 0 )
+        response = (void*) test3f;
+    else if ( strcmp( name, "test3g" ) == 0 )
+        response = (void*) test3g;
+    else if ( strcmp( name, "test3h" ) == 0 )
+        response = (void*) test3h;
+    else if ( strcmp( name, "test3i" ) == 0 )
+        response = (void*) test3i;
+    else if ( strcmp( name, "test3j" ) == 0 )
+        response = (void*) test3j;
+    else if ( strcmp( name, "test3k" ) == 0 )
+        response = (void*) test3k;
+    else if ( strcmp( name, "test3l" ) == 0 )
+        response = (void*) test3l;
+    else if ( strcmp( name, "test3m" ) == 0 )
+        response = (void*) test3m;
+    else if ( strcmp( name, "test3n" ) == 0 )
+        response = (void*) test3n;
+    else if ( strcmp( name, "test3o" ) == 0 )
+        response = (void*) test3o;
+    else if ( strcmp( name, "test3p" ) == 0 )
+        response = (void*) test3p;
+    else
+        response = NULL;
+    return response;
+}
+
+/**
+* Print out the state of the processes whenever it is called.
+* This is basically a glorified wrapper for all these state_printer calls
+*/
+void scheduler_printer(char* action) {
+    int time;
+    PCB* p;
+
+    // this makes sure we don't print out state information
+    // all the time if it is not needed
+    if(print_schedule == 1) {
+        MEM_READ(Z502ClockStatus, &time);
+        SP_setup(SP_TIME_MODE, time);
+
+        SP_setup_action(SP_ACTION_MODE, action);
+
+        if(current_PCB != NULL) {
+            SP_setup(SP_TARGET_MODE, current_PCB->pid);
+            SP_setup( SP_RUNNING_MODE, current_PCB->pid );
+        }
+
+        SP_print_header();
+        SP_print_line();
+    }
+}
+
+/**
+* Prints out the current state of everything in memory
+* both virtual and physical
 */
 void memory_printer() {
     int i = 0;
     int state = 0;
+    Node* cursor;
 
     // makes sure we aren't printing out memory stuff if it is not needed
     if(print_memory == 1) {
-        for(i = 0; i <= PHYS_MEM_PGS; i++) {
-            if(frame_list[i].page_id >= 0 && frame_list[i].page_id < VIRTUAL_MEM_PGS) {
-                state = ((Z502_PAGE_TBL_ADDR[frame_list[i].page_id] & PTBL_VALID_BIT) >> 13) +
-                        ((Z502_PAGE_TBL_ADDR[frame_list[i].page_id] & PTBL_MODIFIED_BIT) >> 13) +
-                        ((Z502_PAGE_TBL_ADDR[frame_list[i].page_id] & PTBL_REFERENCED_BIT) >> 13);
+        // the printout has room for PHYS_MEM_PGS frames
+        for(i = 0; i < phys_mem_pgs && i < PHYS_MEM_PGS; i++) {
+            PCB* owner = find_process(frame_list[i].pid);
+
+            if(owner != NULL && frame_list[i].page_id >= 0 && frame_list[i].page_id < VIRTUAL_MEM_PGS) {
+                state = ((owner->pagetable[frame_list[i].page_id] & PTBL_VALID_BIT) >> 13) +
+                        ((owner->pagetable[frame_list[i].page_id] & PTBL_MODIFIED_BIT) >> 13) +
+                        ((owner->pagetable[frame_list[i].page_id] & PTBL_REFERENCED_BIT) >> 13);
 
-                MP_setup(frame_list[i].frame_id, current_PCB->pid, frame_list[i].page_id, state);
+                MP_setup(frame_list[i].frame_id, owner->pid, frame_list[i].page_id, state);
             }
         }
 
         MP_print_line();
-        printf("\n");
+
+        // and how much of it each process is holding
+        printf("Resident set sizes:");
+        for (cursor = process_list; cursor != NULL; cursor = cursor->next) {
+            PCB* pcb = (PCB*) cursor->data;
+
+            if (pcb != NULL && pcb != root_process_pcb)
+                printf(" %d:%d", pcb->pid, pcb->resident_pages);
+        }
+        printf("\n\n");
     }
 }
 
@@ -1198,150 +2092,1946 @@ void clear_handled_broadcast_message() {
 /**********************************************************
 * All Memory management stuff is defined below here
 ***********************************************************/
-UINT16 find_empty_frame(INT32 status) {
-    int i;
+INT32 find_empty_frame(INT32 status) {
+    INT32 frame = frame_bitmap_alloc(free_frames);
+    INT32 current_time;
 
-    // run through all the Physical memory and find an available frame
-    for(i = 0; i < PHYS_MEM_PGS; i++) {
-        if((frame_list[i]).in_use == FALSE) {
-            frame_list[i].in_use = TRUE;
-            frame_list[i].pid = current_PCB->pid;
-            frame_list[i].page_id = status;
-            return i;
-        }
-    }
+    // if there are no frames left, return -1
+    if (frame == -1)
+        return -1;
 
-    // if no frames are found by now, return -1
-    return -1;
+    frame_list[frame].in_use = TRUE;
+    frame_list[frame].pid = current_PCB->pid;
+    frame_list[frame].page_id = status;
+    frame_list[frame].sharers = 1;
+    MEM_READ(Z502ClockStatus, &current_time);
+    frame_list[frame].last_used = process_virtual_time(current_PCB->pid, current_time);
+    current_PCB->resident_pages++;
+
+    if (pager->page_loaded != NULL)
+        pager->page_loaded(frame_list, phys_mem_pgs, frame);
+    return frame;
 }
 
 /**
-* no empty frames so find an unused one and release it
+* A frame has come free, or can be replaced again.  Faults that found
+* nothing to replace go and look again.  The frames are only ever
+* changed by processes, so nothing can come free between a fault
+* looking and it getting on frame_waiters.
 */
-UINT16 page_replacement() {
-    long disk_id;
-    long sector_id;
-    long frame_id;
-    long page_id;
-    int  victim = current_PCB->pid + 1;
-
-    page_id = frame_list[victim].page_id;
-    frame_id = frame_list[victim].frame_id;
+void frame_available(void) {
+    wait_queue_wake_all(frame_waiters);
+}
 
-    disk_id = current_PCB->pid + 1;
-    sector_id = page_id;
+/**
+* Puts a frame back in the free frame bitmap
+*/
+static void free_frame(INT32 frame) {
+    frame_list[frame].in_use = FALSE;
+    frame_list[frame].pid = -1;
+    frame_list[frame].page_id = -1;
+    frame_list[frame].locked = FALSE;
+    frame_list[frame].prefetched = FALSE;
+    frame_list[frame].sharers = 0;
+    frame_bitmap_free(free_frames, frame);
+
+    if (pager->frame_freed != NULL)
+        pager->frame_freed(frame_list, phys_mem_pgs, frame);
+    frame_available();
+}
 
-    Z502_PAGE_TBL_ADDR[page_id] = PHYS_MEM_PGS;
-    Z502_PAGE_TBL_ADDR[page_id] = (UINT16)Z502_PAGE_TBL_ADDR[page_id] & PTBL_PHYS_PG_NO;
+/**
+* Finds a process other than the owner that has a shared frame mapped
+* at page_id.  Copies are always mapped where the original was.
+*/
+static PCB* find_frame_sharer(INT32 frame, INT32 page_id) {
+    Node* cursor;
+    PCB* pcb;
+
+    for (cursor = process_list; cursor != NULL; cursor = cursor->next) {
+        pcb = (PCB*) cursor->data;
+        if (pcb != NULL && pcb->pid != frame_list[frame].pid && (pcb->pagetable[page_id] & PTBL_VALID_BIT)
+                && (pcb->pagetable[page_id] & PTBL_PHYS_PG_NO) == frame)
+            return pcb;
+    }
+    return NULL;
+}
 
-    // copy the old info into the shadow table
-    shadow_table[page_id].disk_id = disk_id;
-    shadow_table[page_id].sector_id = sector_id;
-    shadow_table[page_id].frame_id = frame_id;
-    shadow_table[page_id].page_id = page_id;
-    shadow_table[page_id].in_use = TRUE;
+/**
+* A process stops using a frame it shares with others.  If it was the
+* owner, the frame goes to one of the processes still using it.
+*/
+static void unshare_frame(PCB* pcb, INT32 page_id, INT32 frame) {
+    PCB* heir;
 
-    // write the contents of the buffer to the disk
-    if(current_PCB->disk_data->buffer != NULL)
-        disk_write(disk_id, sector_id, current_PCB->disk_data->buffer);
+    frame_list[frame].sharers--;
+    frame_available();
+    if (frame_list[frame].pid != pcb->pid)
+        return;
 
-    // free up the frame
-    frame_list[victim].in_use = FALSE;
+    pcb->resident_pages--;
+    heir = find_frame_sharer(frame, page_id);
 
-    return victim;
-}
+    // the count said someone else had it mapped, but nobody does, so nobody needs it
+    if (heir == NULL) {
+        free_frame(frame);
+        return;
+    }
+    frame_list[frame].pid = heir->pid;
+    heir->resident_pages++;
 
-// Just a wrapper for reading the disk status
-// because it has to be done frequently
-int get_disk_status(long disk_id) {
-    INT32 disk_status;
-    MEM_WRITE(Z502DiskSetID, &disk_id);
-    MEM_READ(Z502DiskStatus, &disk_status);
-    return disk_status;
+    // the heir has no copy of the page on swap, so it has to be written out if it is evicted
+    heir->pagetable[page_id] |= PTBL_MODIFIED_BIT;
 }
 
 /**
-* This function is responsible for reading data from the disk.
+* Hand back every frame a process owns, and let go of the ones it
+* shares.  Its page table goes away with it.
 */
-void disk_read(long disk_id, long sector_id, char* read_buffer) {
-    INT32               disk_status;
-    INT32               disk_action;
-    INT32               disk_start;
+void release_frames(PCB* pcb) {
+    INT32 frame;
+    int i;
 
-    MEM_WRITE(Z502DiskSetID, &(current_PCB->disk_data->disk_id));
-    MEM_READ(Z502DiskStatus, &disk_status);
+    if (frame_list == NULL)
+        return;
 
-    while (!(disk_status == DEVICE_FREE)) { //sleep till free
-        sleep_process(20, current_PCB);
-        switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
-        MEM_WRITE(Z502DiskSetID, &(current_PCB->disk_data->disk_id));
-        MEM_READ(Z502DiskStatus, &disk_status);
+    for (i = 0; i < VIRTUAL_MEM_PGS; i++) {
+        frame = pcb->pagetable[i] & PTBL_PHYS_PG_NO;
+        if ((pcb->pagetable[i] & PTBL_VALID_BIT) && frame != zero_frame && frame_list[frame].sharers > 1)
+            unshare_frame(pcb, i, frame);
     }
 
-    MEM_WRITE(Z502DiskSetID, &(current_PCB->disk_data->disk_id));
-    MEM_WRITE(Z502DiskSetSector, &(current_PCB->disk_data->sector_id));
-
-    MEM_WRITE(Z502DiskSetBuffer, (INT16 *)(current_PCB->disk_data->buffer));
+    // a frame that is locked is already being handed to someone else
+    for(i = 0; i < phys_mem_pgs; i++) {
+        if (frame_list[i].in_use && frame_list[i].pid == pcb->pid && !frame_list[i].locked)
+            free_frame(i);
+    }
+    pcb->resident_pages = 0;
+}
 
-    disk_action = 0;
-    MEM_WRITE(Z502DiskSetAction, &(disk_action));  //set to read from disk
-    disk_start = 0;
-    disk_queue[(INT32)current_PCB->disk_data->disk_id] = current_PCB;
-    MEM_WRITE(Z502DiskStart, &(disk_start));
+/**
+* Hands back the page table entry for whatever page is in a frame,
+* or NULL if nobody owns the frame any more
+*/
+UINT16* frame_page_entry(INT32 frame) {
+    PCB* owner;
 
-    MEM_WRITE(Z502DiskSetID, &(current_PCB->disk_data->disk_id));
-    MEM_READ(Z502DiskStatus, &disk_status);
+    if (!frame_list[frame].in_use || frame_list[frame].page_id < 0)
+        return NULL;
 
-    if(disk_status == DEVICE_FREE) {
-        printf("Error!  Disk is free and should be in use\n");
-    }
-    else if(disk_status == ERR_BAD_DEVICE_ID) {
-        printf("Error!  Disk write was not set up correctly\n");
-    }
-    else {
-        // suspend the process for the duration of the read
-        current_PCB->state = SUSPEND;
-        current_PCB->suspend_reason = WAITING_FOR_DISK;
+    owner = find_process(frame_list[frame].pid);
+    if (owner == NULL)
+        return NULL;
 
-        // switch to the root process so we keep running while the other process is reading
-        switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
-    }
+    return &owner->pagetable[frame_list[frame].page_id];
 }
 
 /**
-* This function is responsible for writing data to the disk.
+* TRUE if the replacement policy may take this frame.  Frames being
+* written out are off limits, and so are free ones, since those belong
+* to the free frame bitmap.  So are frames shared copy on write, which
+* would have to be taken away from every process at once.  When pid is
+* given only that process's own frames may go, otherwise a process that
+* is down to its minimum resident set keeps what it has.
 */
-void disk_write(long disk_id, long sector_id, char* write_buffer) {
-    INT32 disk_status;
-    MEM_WRITE(Z502DiskSetID, &disk_id);
-    MEM_READ(Z502DiskStatus, &disk_status);
+BOOL frame_evictable(INT32 frame, INT32 pid) {
+    PCB* owner;
 
-    // make sure the device is available
-    if (disk_status == DEVICE_FREE) {
-        MEM_WRITE(Z502DiskSetID, &disk_id);
-        MEM_WRITE(Z502DiskSetSector, &sector_id);
-        MEM_WRITE(Z502DiskSetBuffer, (INT32*) write_buffer);
+    if (frame_list[frame].locked || !frame_list[frame].in_use || frame_list[frame].sharers > 1)
+        return FALSE;
+    if (pid != -1)
+        return frame_list[frame].pid == pid;
 
-        // tell the disk we are going to write
-        disk_status = 1;
-        MEM_WRITE(Z502DiskSetAction, &disk_status);
-        disk_status = 0;
+    owner = find_process(frame_list[frame].pid);
+    return owner == NULL || owner->resident_pages > owner->min_resident;
+}
+
+/**
+* A process's virtual time: how many ticks of CPU it has had, counting
+* the time slice it is in the middle of if it is the one running
+*/
+long process_virtual_time(INT32 pid, INT32 current_time) {
+    PCB* pcb = find_process(pid);
+
+    if (pcb == NULL)
+        return 0;
+    if (pcb != current_PCB)
+        return pcb->time_spent_processing;
+
+    return pcb->time_spent_processing + (current_time - last_context_switch);
+}
+
+/**
+* A page that was read ahead has either been used or evicted without
+* being used.  The process reads further ahead the more of them it uses,
+* and stops reading ahead of a stream that keeps wasting them.
+*/
+static void prefetch_resolved(PCB* pcb, INT32 page_id, BOOL used) {
+    INT32 i;
+
+    pcb->shadow_table[page_id].prefetched = FALSE;
+    for (i = 0; i < pcb->prefetch_pending; i++) {
+        if (pcb->prefetch_pages[i] == page_id) {
+            pcb->prefetch_pages[i] = pcb->prefetch_pages[pcb->prefetch_pending - 1];
+            break;
+        }
+    }
+    pcb->prefetch_pending--;
+
+    if (used) {
+        prefetch_hits++;
+        if (pcb->readahead_window < readahead_max)
+            pcb->readahead_window++;
+    }
+    else {
+        prefetch_waste++;
+        pcb->readahead_window /= 2;
+    }
+}
+
+/**
+* Takes the page in a frame away from whichever process it belonged to.
+* Returns TRUE if the page was modified, so it has to be written out
+* before the frame can be used for anything else.
+*/
+static BOOL unmap_frame(INT32 frame) {
+    UINT16* entry = frame_page_entry(frame);
+    PCB* owner = frame_list[frame].in_use ? find_process(frame_list[frame].pid) : NULL;
+    INT32 page_id = frame_list[frame].page_id;
+    BOOL dirty = FALSE;
+
+    if (owner != NULL)
+        owner->resident_pages--;
+
+    if (entry != NULL) {
+        if (owner->shadow_table != NULL && owner->shadow_table[page_id].prefetched)
+            prefetch_resolved(owner, page_id, (*entry & (PTBL_REFERENCED_BIT | PTBL_MODIFIED_BIT)) != 0);
+
+        dirty = (*entry & PTBL_MODIFIED_BIT) != 0;
+        *entry = PHYS_MEM_PGS;
+        *entry = (UINT16)*entry & PTBL_PHYS_PG_NO;
+    }
+    return dirty;
+}
+
+/**
+* Asks the replacement policy for a victim.  A process at its maximum
+* resident set only replaces its own pages.  Anyone else picks from
+* everybody, and falls back on its own pages when every other process
+* is down to its minimum.
+*/
+static INT32 choose_replacement_victim(void) {
+    INT32 current_time;
+    INT32 victim;
+
+    MEM_READ(Z502ClockStatus, &current_time);
+
+    if (current_PCB->max_resident > 0 && current_PCB->resident_pages >= current_PCB->max_resident)
+        return pager->choose_victim(frame_list, phys_mem_pgs, current_PCB->pid, current_time, ws_window);
+
+    victim = pager->choose_victim(frame_list, phys_mem_pgs, -1, current_time, ws_window);
+    if (victim == -1 && current_PCB->resident_pages > 0)
+        victim = pager->choose_victim(frame_list, phys_mem_pgs, current_PCB->pid, current_time, ws_window);
+    return victim;
+}
+
+/**
+* No empty frames, so the replacement policy picks a victim.  It is taken
+* away from its owner, written out if it was modified, and handed over to
+* the current process for page_id.
+*/
+INT32 page_replacement(INT32 page_id) {
+    INT32 victim = choose_replacement_victim();
+    INT32 current_time;
+
+    // every frame is on its way out to disk or shared, wait for one to come free
+    while (victim == -1) {
+        if (!drop_shared_page()) {
+            wait_queue_add(frame_waiters, current_PCB);
+            give_up_cpu();
+        }
+
+        // somebody may have exited and left a frame in the meantime
+        if ((current_PCB->max_resident == 0 || current_PCB->resident_pages < current_PCB->max_resident)
+                && (victim = find_empty_frame(page_id)) != -1)
+            return victim;
+        victim = choose_replacement_victim();
+    }
+
+    // nobody else may pick this frame while we are writing it out
+    frame_list[victim].locked = TRUE;
+    page_replacements++;
+
+    if (unmap_frame(victim)) {
+        page_out(victim);
+        dirty_replacements++;
+    }
+
+    frame_list[victim].pid = current_PCB->pid;
+    frame_list[victim].page_id = page_id;
+    frame_list[victim].in_use = TRUE;
+    frame_list[victim].prefetched = FALSE;
+    frame_list[victim].sharers = 1;
+    MEM_READ(Z502ClockStatus, &current_time);
+    frame_list[victim].last_used = process_virtual_time(current_PCB->pid, current_time);
+    frame_list[victim].locked = FALSE;
+    frame_available();
+    current_PCB->resident_pages++;
+
+    if (pager->page_loaded != NULL)
+        pager->page_loaded(frame_list, phys_mem_pgs, victim);
+
+    return victim;
+}
+
+/**
+* A process's shadow table entry for a page, making the shadow table
+* the first time it needs one
+*/
+static SHADOW_TABLE* shadow_entry(PCB* pcb, INT32 page_id) {
+    int i;
+
+    // the shadow table is looked up by page number
+    if (pcb->shadow_table == NULL) {
+        pcb->shadow_table = (SHADOW_TABLE*) calloc(sizeof(SHADOW_TABLE), VIRTUAL_MEM_PGS);
+        for (i = 0; i < VIRTUAL_MEM_PGS; i++) {
+            pcb->shadow_table[i].page_id = i;
+            pcb->shadow_table[i].frame_id = -1;
+            pcb->shadow_table[i].disk_id = -1;
+            pcb->shadow_table[i].sector_id = -1;
+            pcb->shadow_table[i].in_use = FALSE;
+            pcb->shadow_table[i].prefetched = FALSE;
+        }
+    }
+    return &pcb->shadow_table[page_id];
+}
+
+/**
+* Finds the sector in the swap area a frame's page goes to, giving it one
+* if it doesn't have one yet, and marks the page as on its way out from
+* the frame.  Returns FALSE if the owner is gone and there is nothing to write.
+*/
+static BOOL reserve_swap_slot(INT32 frame, SHADOW_TABLE* slot) {
+    INT32 pid = frame_list[frame].pid;
+    INT32 page_id = frame_list[frame].page_id;
+    PCB* owner = find_process(pid);
+    SHADOW_TABLE* entry;
+
+    if (owner == NULL)
+        return FALSE;
+
+    entry = shadow_entry(owner, page_id);
+    if (!entry->in_use && !swap_alloc(swap_area, entry)) {
+        printf("Error!  Out of swap space paging out page %d of process %d\n", page_id, pid);
+        Z502Halt();
+    }
+    entry->frame_id = frame;
+    *slot = *entry;
+    return TRUE;
+}
+
+/**
+* Gives a sector back to the swap area.  Once that leaves a whole cluster
+* of sectors free, a solid state disk is told it can forget them; one
+* trim for the lot costs a lot less than one for each.
+*/
+static void free_swap_slot(SHADOW_TABLE* slot) {
+    INT32 disk_id = slot->disk_id;
+    INT32 sector_id = slot->sector_id;
+
+    if (!slot->in_use)
+        return;
+    swap_free(swap_area, slot);
+    if (disk_is_ssd(disk_id) && swap_cluster_is_free(swap_area, disk_id, sector_id))
+        trim_sectors(disk_id, sector_id - sector_id % SWAP_TRIM_CLUSTER, SWAP_TRIM_CLUSTER);
+}
+
+/**
+* A page has made it out to swap, so its owner can read it back in.  The
+* owner may have gone away while it was being written, and left the
+* sector to us.
+*/
+static void swap_write_done(INT32 pid, INT32 page_id, SHADOW_TABLE* slot) {
+    PCB* owner = find_process(pid);
+
+    if (owner != NULL) {
+        owner->shadow_table[page_id].frame_id = -1;
+        wait_queue_wake(page_waiters, owner);
+    }
+    else
+        free_swap_slot(slot);
+}
+
+/**
+* Writes the contents of a frame out to its owner's place in the swap
+* area.  A page keeps its place once it has one, so a page that is
+* written out again goes to the same sector.  Until the write is done
+* the shadow table entry says which frame it is coming from, and the
+* owner has to wait for it if it faults the page back in.
+*/
+void page_out(INT32 frame) {
+    INT32 pid = frame_list[frame].pid;
+    INT32 page_id = frame_list[frame].page_id;
+    SHADOW_TABLE slot;
+    char data[PGSIZE];
+
+    if (!reserve_swap_slot(frame, &slot))
+        return;
+
+    Z502ReadPhysicalMemory(frame, data);
+    swap_transfer(slot.disk_id, slot.sector_id, data, DISK_WRITE);
+    swap_write_done(pid, page_id, &slot);
+}
+
+/**
+* Reads a page of the current process back from the swap area into a frame
+*/
+void page_in(INT32 frame, INT32 page_id) {
+    SHADOW_TABLE* entry = &current_PCB->shadow_table[page_id];
+    char data[PGSIZE];
+
+    swap_transfer(entry->disk_id, entry->sector_id, data, DISK_READ);
+    Z502WritePhysicalMemory(frame, data);
+}
+
+/**
+* Moves a page between memory and the swap area, waiting behind whatever
+* else the disk has queued
+*/
+void swap_transfer(long disk_id, long sector_id, char* data, int operation) {
+    if (operation == DISK_WRITE)
+        disk_write(disk_id, sector_id, data);
+    else
+        disk_read(disk_id, sector_id, data);
+}
+
+/**
+* Hand back every sector of the swap area a process was using.  One that
+* is still being written out is freed by page_out once the write is done.
+*/
+void release_swap(PCB* pcb) {
+    int i;
+
+    if (pcb->shadow_table == NULL)
+        return;
+
+    for (i = 0; i < VIRTUAL_MEM_PGS; i++) {
+        if (pcb->shadow_table[i].frame_id == -1)
+            free_swap_slot(&pcb->shadow_table[i]);
+    }
+    free(pcb->shadow_table);
+    pcb->shadow_table = NULL;
+}
+
+/************************************************************************
+    COPY ON WRITE
+        A page nobody has written to yet is mapped read only to the zero
+        frame, so reading it costs no frame at all.  A process made with
+        CREATE_PROCESS_COPY starts out sharing every page its creator has
+        in memory, read only in both page tables.  The first write to a
+        read only page faults, and the writer gets a frame of its own
+        with the same contents.  The last process left using a shared
+        frame just has its page made writable again.
+************************************************************************/
+
+/**
+* Gets a frame for a page of the current process, a free one if it may
+* have one, otherwise one the replacement policy takes from someone
+*/
+INT32 take_frame(INT32 page_id) {
+    INT32 frame = -1;
+
+    // a process that already holds its limit has to give up one of its own
+    if (current_PCB->max_resident == 0 || current_PCB->resident_pages < current_PCB->max_resident)
+        frame = find_empty_frame(page_id);
+
+    if (frame == -1)
+        frame = page_replacement(page_id);
+    return frame;
+}
+
+/**
+* The current process wrote to a page it has mapped read only
+*/
+void copy_on_write(INT32 page_id) {
+    UINT16* entry = &current_PCB->pagetable[page_id];
+    INT32 shared = *entry & PTBL_PHYS_PG_NO;
+    INT32 frame;
+    char data[PGSIZE];
+
+    // nobody else is using it any more
+    if (shared != zero_frame && frame_list[shared].sharers == 1) {
+        *entry &= ~PTBL_READ_ONLY_BIT;
+        return;
+    }
+
+    // nobody can write to it, so the copy is good even if we have to wait for a frame
+    if (shared == zero_frame)
+        memset(data, 0, PGSIZE);
+    else
+        Z502ReadPhysicalMemory(shared, data);
+
+    frame = take_frame(page_id);
+    Z502WritePhysicalMemory(frame, data);
+    cow_copies++;
+
+    // the others may have let go of it while we waited, and it may even
+    // have been evicted, in which case it is gone already
+    if ((*entry & PTBL_VALID_BIT) && (*entry & PTBL_PHYS_PG_NO) == shared && shared != zero_frame) {
+        if (frame_list[shared].sharers > 1)
+            unshare_frame(current_PCB, page_id, shared);
+        else {
+            current_PCB->resident_pages--;
+            free_frame(shared);
+        }
+    }
+
+    // modified, since there is no copy of it on swap that is ours
+    *entry = (UINT16) frame_list[frame].frame_id | PTBL_VALID_BIT | PTBL_REFERENCED_BIT | PTBL_MODIFIED_BIT;
+}
+
+/**
+* Nothing can be evicted, since a shared frame never is.  The current
+* process puts its own copy of a page it shares out on swap and lets go
+* of the frame, so in the end only one process is left using it and it
+* can go like any other.  Returns FALSE if it doesn't share anything.
+*/
+BOOL drop_shared_page(void) {
+    SHADOW_TABLE* slot;
+    UINT16* entry;
+    INT32 frame;
+    INT32 page_id;
+    char data[PGSIZE];
+
+    for (page_id = 0; page_id < VIRTUAL_MEM_PGS; page_id++) {
+        entry = &current_PCB->pagetable[page_id];
+        frame = *entry & PTBL_PHYS_PG_NO;
+        if (!(*entry & PTBL_VALID_BIT) || frame == zero_frame || frame_list[frame].sharers < 2)
+            continue;
+
+        Z502ReadPhysicalMemory(frame, data);
+        slot = shadow_entry(current_PCB, page_id);
+        if (!slot->in_use && !swap_alloc(swap_area, slot)) {
+            printf("Error!  Out of swap space dropping page %d of process %d\n", page_id, current_PCB->pid);
+            Z502Halt();
+        }
+        swap_transfer(slot->disk_id, slot->sector_id, data, DISK_WRITE);
+
+        // the others may have let go of it while we were writing, and left it to us
+        if ((*entry & PTBL_VALID_BIT) && (*entry & PTBL_PHYS_PG_NO) == frame && frame_list[frame].sharers > 1) {
+            *entry = PHYS_MEM_PGS & PTBL_PHYS_PG_NO;
+            unshare_frame(current_PCB, page_id, frame);
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+* Gives a new process a copy of the current process's memory.  Pages
+* that are in memory are shared.  Pages out on swap are copied sector
+* for sector, since a sector only ever belongs to one page.
+*/
+void clone_address_space(PCB* child) {
+    PCB* parent = current_PCB;
+    SHADOW_TABLE* slot;
+    UINT16 entry;
+    INT32 frame;
+    INT32 page_id;
+    char data[PGSIZE];
+
+    for (page_id = 0; page_id < VIRTUAL_MEM_PGS; page_id++) {
+        // a page on its way in or out has to get there first
+        while (parent->shadow_table != NULL && parent->shadow_table[page_id].frame_id != -1) {
+            wait_queue_add(page_waiters, current_PCB);
+            give_up_cpu();
+        }
+
+        entry = parent->pagetable[page_id];
+        if (entry & PTBL_VALID_BIT) {
+            frame = entry & PTBL_PHYS_PG_NO;
+            if (frame != zero_frame)
+                frame_list[frame].sharers++;
+
+            parent->pagetable[page_id] |= PTBL_READ_ONLY_BIT;
+            child->pagetable[page_id] = (UINT16) frame | PTBL_VALID_BIT | PTBL_READ_ONLY_BIT;
+            pages_shared++;
+        }
+        else if (parent->shadow_table != NULL && parent->shadow_table[page_id].in_use) {
+            swap_transfer(parent->shadow_table[page_id].disk_id, parent->shadow_table[page_id].sector_id,
+                          data, DISK_READ);
+
+            slot = shadow_entry(child, page_id);
+            if (!swap_alloc(swap_area, slot)) {
+                printf("Error!  Out of swap space copying page %d for process %d\n", page_id, child->pid);
+                Z502Halt();
+            }
+            swap_transfer(slot->disk_id, slot->sector_id, data, DISK_WRITE);
+        }
+    }
+}
+
+/**
+* TRUE if the disk has nothing going and nothing waiting.  The caller
+* holds the disk lock.
+*/
+static BOOL disk_idle(long disk_id) {
+    return disk_queue_idle(disk_queue[disk_id]);
+}
+
+/**
+* Same as block_device_idle, taking the disk lock to look.  The swap area
+* is handed this to steer pages towards idle disks.
+*/
+BOOL disk_is_free(long disk_id) {
+    BOOL free;
+
+    lock_disk();
+    free = block_device_idle(disk_id);
+    unlock_disk();
+    return free;
+}
+
+/**
+* TRUE if a disk is one of the solid state ones at the top of the range.
+* A volume isn't, whatever it is made of.
+*/
+BOOL disk_is_ssd(long disk_id) {
+    return disk_id <= MAX_NUMBER_OF_DISKS && disk_id > MAX_NUMBER_OF_DISKS - ssd_disks;
+}
+
+/**
+* TRUE if a disk takes writes into a volatile write cache, so they aren't
+* safe once it says they are done
+*/
+BOOL disk_has_write_cache(long disk_id) {
+    return write_cache > 0 && !disk_is_ssd(disk_id);
+}
+
+/**
+* Starts the next transfers waiting for a disk, as many as the disk can
+* work on at once.  The disk scheduling policy decides which go.  The
+* caller holds the disk lock.
+*/
+void dispatch_disk(long disk_id) {
+    DISK_REQUEST* request;
+    INT32 disk_action;
+
+    while (!disk_queue_full(disk_queue[disk_id])) {
+        request = disk_queue_next(disk_queue[disk_id], disk_policy);
+        if (request == NULL)
+            return;
 
-        // write what we need to write and add the process to the disk queue
-        MEM_WRITE(Z502DiskStart, &disk_status);
         MEM_WRITE(Z502DiskSetID, &disk_id);
-        MEM_READ(Z502DiskStatus, &disk_status);
-        disk_queue[(INT32)current_PCB->disk_data->disk_id] = current_PCB;
+        MEM_WRITE(Z502DiskSetSector, &request->sector_id);
+        MEM_WRITE(Z502DiskSetBuffer, (INT32*) request->buffer);
+
+        // tell the disk whether we are going to read, write, trim or flush
+        if (request->operation == DISK_WRITE)
+            disk_action = DISK_ACTION_WRITE;
+        else if (request->operation == DISK_WRITE_FUA)
+            disk_action = DISK_ACTION_WRITE_FUA;
+        else if (request->operation == DISK_TRIM)
+            disk_action = DISK_ACTION_TRIM;
+        else if (request->operation == DISK_FLUSH)
+            disk_action = DISK_ACTION_FLUSH;
+        else
+            disk_action = DISK_ACTION_READ;
+
+        // a flush takes in every write the disk has finished, and nothing
+        // else is going on a spinning disk while it runs
+        if (request->operation == DISK_FLUSH)
+            unflushed_writes[disk_id] = 0;
+        MEM_WRITE(Z502DiskSetAction, &disk_action);
+        if (request->operation == DISK_TRIM)
+            MEM_WRITE(Z502DiskSetCount, &request->sector_count);
+        MEM_WRITE(Z502DiskSetTag, &request->tag);
+        disk_action = 0;
+        MEM_WRITE(Z502DiskStart, &disk_action);
+    }
+}
+
+/**
+* Fills in what a transfer is, and that it is on its way from now
+*/
+static void start_disk_request(DISK_REQUEST* request, long disk_id, long sector_id, char* buffer,
+                               int operation, PCB* waiter, WaitQueue wait_queue) {
+    request->disk_id = disk_id;
+    request->sector_id = sector_id;
+    request->buffer = buffer;
+    request->operation = operation;
+    request->waiter = waiter;
+    request->wait_queue = wait_queue;
+    request->done = FALSE;
+    request->abandoned = FALSE;
+    request->parent = NULL;
+    MEM_READ(Z502ClockStatus, &request->queued_at);
+}
+
+/**
+* Hands a transfer to a disk.  It starts straight away if the disk has
+* nothing else to do, otherwise it waits its turn on the disk's queue.
+* The interrupt handler wakes waiter from wait_queue when it is done.
+* The caller holds the disk lock, and the request and its buffer have to
+* stay put until the transfer is done.
+*/
+static void submit_disk_request(DISK_REQUEST* request, long disk_id, long sector_id, char* buffer,
+                                int operation, PCB* waiter, WaitQueue wait_queue) {
+    DISK_REQUEST* trim;
+
+    start_disk_request(request, disk_id, sector_id, buffer, operation, waiter, wait_queue);
+
+    // a trim still waiting would forget what this writes if the policy took it
+    // later.  A trim is only advice, so it can just go.
+    if (operation == DISK_WRITE || operation == DISK_WRITE_FUA) {
+        for (trim = disk_queue[disk_id]->first; trim != NULL; trim = trim->next) {
+            if (trim->operation == DISK_TRIM && sector_id >= trim->sector_id
+                    && sector_id < trim->sector_id + trim->sector_count)
+                break;
+        }
+        if (trim != NULL) {
+            disk_queue_remove(disk_queue[disk_id], trim);
+            disk_trims -= trim->sector_count;
+            free(trim);
+        }
+    }
+
+    disk_queue_add(disk_queue[disk_id], request);
+    dispatch_disk(disk_id);
+}
+
+/**
+* Called by the interrupt handler, with the disk lock held, once a disk
+* is done with a transfer.  Only the process waiting for it is woken.
+* That may be the page-out daemon asleep on the timer, rather than on
+* its wait queue, when a read ahead it looks after finishes; it sees to
+* it when it wakes up.  A piece of a transfer on a volume frees itself,
+* and the transfer is done once its last piece is.
+*/
+void finish_disk_request(DISK_REQUEST* request) {
+    DISK_REQUEST* whole;
+    INT32 current_time;
+
+    MEM_READ(Z502ClockStatus, &current_time);
+    disk_requests++;
+    disk_wait_total += current_time - request->queued_at;
+    if (current_time - request->queued_at > disk_wait_worst)
+        disk_wait_worst = current_time - request->queued_at;
+    if (request->operation == DISK_WRITE && disk_has_write_cache(request->disk_id))
+        unflushed_writes[request->disk_id]++;
+    if (request->operation == DISK_WRITE_FUA)
+        fua_writes++;
+
+    if (request->parent != NULL) {
+        whole = request->parent;
+        free(request);
+        if (--whole->pending > 0)
+            return;
+        request = whole;
+    }
+
+    if (request->abandoned) {
+        free(request);
+        return;
+    }
+
+    request->done = TRUE;
+    if (request->waiter != NULL)
+        wait_queue_wake(request->wait_queue, request->waiter);
+
+    // one that asked to be told goes into its waiter's mailbox now, which lets go of it
+    if (request->notify)
+        post_async_completions(request->waiter);
+}
+
+/**
+* Tells a solid state disk that count sectors of it, from sector_id on,
+* no longer hold anything, so it doesn't have to keep them.  Nobody waits
+* for it; the request frees itself once the disk is done.  Does nothing
+* on a spinning disk.
+*/
+void trim_sectors(long disk_id, long sector_id, INT32 count) {
+    DISK_REQUEST* request;
+
+    if (!disk_is_ssd(disk_id))
+        return;
+    request = (DISK_REQUEST*) calloc(1, sizeof(DISK_REQUEST));
+    if (request == NULL)
+        return;
+
+    request->sector_count = count;
+    lock_disk();
+    start_disk_request(request, disk_id, sector_id, NULL, DISK_TRIM, NULL, NULL);
+
+    // nobody waits for it, so it has to know to free itself before the disk can have it
+    request->abandoned = TRUE;
+    disk_trims += count;
+    disk_queue_add(disk_queue[disk_id], request);
+    dispatch_disk(disk_id);
+    unlock_disk();
+}
+
+/************************************************************************
+    VOLUMES
+        A volume puts several disks together as one more disk, numbered
+        after the real ones, that DISK_READ, DISK_WRITE and the rest
+        take like any other.  RAID-0 stripes its sectors across the
+        members for bandwidth; RAID-1 mirrors them, so a read can go to
+        whichever member is least busy, or has its head nearest.  The
+        swap area can be put on volumes made of the swap disks too.  A
+        transfer on a volume is split into pieces for the members it
+        touches, each an ordinary transfer on its disk, and is done once
+        they all are.  Volumes don't pass trims on.
+************************************************************************/
+
+/**
+* The volume that answers to a disk number, or NULL if it is a real disk
+* or nothing at all
+*/
+static Volume find_volume(long disk_id) {
+    if (disk_id <= MAX_NUMBER_OF_DISKS || disk_id > MAX_NUMBER_OF_DISKS + volume_count)
+        return NULL;
+    return volumes[disk_id - MAX_NUMBER_OF_DISKS - 1];
+}
+
+/**
+* Returns the volume a disk is a member of, or NULL if it is on its own
+*/
+static Volume volume_of_member(long disk_id) {
+    INT32 i;
+
+    for (i = 0; i < volume_count; i++) {
+        if (volume_has_member(volumes[i], disk_id))
+            return volumes[i];
+    }
+    return NULL;
+}
+
+/**
+* TRUE if there is a disk or a volume by that number that a process can
+* use.  A disk that is in a volume is only there through the volume;
+* written to on its own, it would pull the blocks out from under it.
+* The swap disks, or the volumes made of them, belong to the pager.
+*/
+BOOL block_device_exists(long disk_id) {
+    if (disk_id >= swap_first_disk && disk_id < swap_first_disk + swap_devices)
+        return FALSE;
+    if (disk_id >= 1 && disk_id <= MAX_NUMBER_OF_DISKS)
+        return volume_of_member(disk_id) == NULL;
+    return find_volume(disk_id) != NULL;
+}
+
+/**
+* Return the number of sectors on a disk or a volume
+*/
+INT32 block_device_sectors(long disk_id) {
+    Volume v = find_volume(disk_id);
+
+    if (v == NULL)
+        return NUM_LOGICAL_SECTORS;
+    return volume_sector_count(v);
+}
+
+/**
+* TRUE if a disk, or every member of a volume, has nothing going and
+* nothing waiting.  The caller holds the disk lock.
+*/
+BOOL block_device_idle(long disk_id) {
+    Volume v = find_volume(disk_id);
+    INT32 disk;
+
+    if (v == NULL)
+        return disk_idle(disk_id);
+    for (disk = v->first_disk; disk < v->first_disk + v->member_count; disk++) {
+        if (!disk_idle(disk))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+* The disk a sector of a disk or volume is on; on a mirror, the first
+* member.  The page-out daemon keeps one transfer going on each.
+*/
+static INT32 block_home_disk(long disk_id, long sector_id) {
+    Volume v = find_volume(disk_id);
+    INT32 disk;
+    INT32 member_sector;
+
+    if (v == NULL)
+        return disk_id;
+    volume_locate(v, sector_id, &disk, &member_sector);
+    return disk;
+}
+
+/**
+* Hands a transfer to a disk or a volume.  One on a volume goes to the
+* member that has the sector on RAID-0.  On RAID-1 a read goes to the
+* member the mirror policy picks, and anything else to every member.
+* Otherwise it is just like submit_disk_request.
+*/
+static void submit_block_request(DISK_REQUEST* request, long disk_id, long sector_id, char* buffer,
+                                 int operation, PCB* waiter, WaitQueue wait_queue) {
+    Volume v = find_volume(disk_id);
+    DISK_REQUEST* piece;
+    INT32 member;
+    INT32 last_member;
+    INT32 member_sector;
+
+    if (v == NULL) {
+        submit_disk_request(request, disk_id, sector_id, buffer, operation, waiter, wait_queue);
+        return;
+    }
+
+    start_disk_request(request, disk_id, sector_id, buffer, operation, waiter, wait_queue);
+    volume_locate(v, sector_id, &member, &member_sector);
+    last_member = member;
+    if (v->type == VOLUME_RAID1 && operation == DISK_READ)
+        member = last_member = volume_pick_mirror(v, disk_queue, sector_id, mirror_policy);
+    else if (v->type == VOLUME_RAID1)
+        last_member = v->first_disk + v->member_count - 1;
+
+    if (operation == DISK_READ) {
+        v->reads++;
+        v->member_reads[member - v->first_disk]++;
+    }
+    else
+        v->writes++;
+
+    // every piece shares the buffer, which stays put until the last is done.
+    // None of them can finish while we hold the disk lock.
+    request->pending = last_member - member + 1;
+    for (; member <= last_member; member++) {
+        piece = (DISK_REQUEST*) calloc(1, sizeof(DISK_REQUEST));
+        submit_disk_request(piece, member, member_sector, buffer, operation, NULL, NULL);
+        piece->parent = request;
+    }
+}
+
+/**
+* Adds a volume of member_count disks from first_disk on.  Returns the
+* disk number it answers to, or -1 if there are too many already.
+*/
+INT32 add_volume(INT32 type, INT32 first_disk, INT32 member_count) {
+    if (volume_count == MAX_VOLUMES) {
+        printf("No more than %d volumes, leaving out disks %d-%d\n", MAX_VOLUMES, first_disk,
+               first_disk + member_count - 1);
+        return -1;
+    }
+
+    volumes[volume_count] = create_volume(MAX_NUMBER_OF_DISKS + 1 + volume_count, type, first_disk,
+                                          member_count, stripe_sectors);
+    return volumes[volume_count++]->volume_id;
+}
+
+/**
+* Sets up a volume from what follows -volume=, its kind and the disks
+* that make it up, as in raid0:1-4.  A disk can only be in the one
+* volume, and not in one at all if it is a swap disk.  The other
+* options are all in by now, so we know which disks those are.
+*/
+void parse_volume(char* spec) {
+    char kind[8];
+    INT32 first_disk;
+    INT32 last_disk;
+    INT32 disk;
+
+    if (sscanf(spec, "%7[^:]:%d-%d", kind, &first_disk, &last_disk) != 3
+            || (strcmp(kind, "raid0") != 0 && strcmp(kind, "raid1") != 0)
+            || first_disk < 1 || last_disk > MAX_NUMBER_OF_DISKS || last_disk < first_disk) {
+        printf("Volume %s should be raid0 or raid1 and a run of disks, as in raid0:1-4\n", spec);
+        return;
+    }
+    for (disk = first_disk; disk <= last_disk; disk++) {
+        if (volume_of_member(disk) != NULL) {
+            printf("Leaving out volume %s, disk %d is already in volume %d\n", spec, disk,
+                   volume_of_member(disk)->volume_id);
+            return;
+        }
+        if (disk > MAX_NUMBER_OF_DISKS - swap_disks) {
+            printf("Leaving out volume %s, disk %d is a swap disk\n", spec, disk);
+            return;
+        }
+    }
+    add_volume(strcmp(kind, "raid1") == 0 ? VOLUME_RAID1 : VOLUME_RAID0, first_disk, last_disk - first_disk + 1);
+}
+
+/**
+* Works out what the swap area is spread over: the swap disks, or with
+* -swap_volume= one RAID-0 volume of them all, or RAID-1 pairs of them.
+* An odd disk left over goes in the last pair.  Either pages out slower
+* than the bare disks: swap_alloc can only pick an idle device, and on
+* one RAID-0 volume the stripe picks the member for it, while a RAID-1
+* pair writes every page twice.  Volumes are for a swap area that has
+* to survive a disk, not for speed.
+*/
+void build_swap_volumes(void) {
+    INT32 first_disk = MAX_NUMBER_OF_DISKS - swap_disks + 1;
+    INT32 pairs = swap_disks / 2;
+    INT32 i;
+
+    swap_first_disk = first_disk;
+    swap_devices = swap_disks;
+    if (swap_volume == VOLUME_RAID0 && volume_count < MAX_VOLUMES) {
+        swap_first_disk = add_volume(VOLUME_RAID0, first_disk, swap_disks);
+        swap_devices = 1;
+    }
+    else if (swap_volume == VOLUME_RAID1 && pairs > 0 && volume_count + pairs <= MAX_VOLUMES) {
+        swap_first_disk = MAX_NUMBER_OF_DISKS + 1 + volume_count;
+        for (i = 0; i < pairs; i++)
+            add_volume(VOLUME_RAID1, first_disk + 2 * i, i == pairs - 1 ? swap_disks - 2 * i : 2);
+        swap_devices = pairs;
+    }
+    else if (swap_volume != -1)
+        printf("Can't make swap volumes of %d disks, swapping straight to them\n", swap_disks);
+}
+
+/**
+* Hands a transfer of the current process's to its disk and waits until
+* the disk is done with it
+*/
+static void disk_transfer(long disk_id, long sector_id, char* buffer, int operation) {
+    DISK_REQUEST request;
+
+    lock_disk();
+    submit_block_request(&request, disk_id, sector_id, buffer, operation, current_PCB, disk_waiters[disk_id]);
+
+    // the interrupt handler lets us go under the disk lock, so we can't miss it
+    while (!request.done) {
+        wait_queue_add(disk_waiters[disk_id], current_PCB);
+        unlock_disk();
+        give_up_cpu();
+        lock_disk();
+    }
+    unlock_disk();
+}
+
+/**
+* This function is responsible for reading data from the disk.
+*/
+void disk_read(long disk_id, long sector_id, char* read_buffer) {
+    disk_transfer(disk_id, sector_id, read_buffer, DISK_READ);
+}
+
+/**
+* This function is responsible for writing data to the disk.
+*/
+void disk_write(long disk_id, long sector_id, char* write_buffer) {
+    disk_transfer(disk_id, sector_id, write_buffer, DISK_WRITE);
+}
+
+/**
+* Makes sure every write a disk has finished is on its platter, not just
+* in its write cache, or those of every disk if disk_id is -1, or of
+* every member if it is a volume.  A disk with nothing taken in since
+* its last flush is left alone.
+*/
+void flush_disk_caches(long disk_id) {
+    DISK_REQUEST requests[MAX_NUMBER_OF_DISKS + 1];
+    BOOL flushing[MAX_NUMBER_OF_DISKS + 1];
+    long disk;
+
+    lock_disk();
+    for (disk = 1; disk <= MAX_NUMBER_OF_DISKS; disk++) {
+        flushing[disk] = (disk_id == -1 || disk == disk_id || volume_has_member(find_volume(disk_id), disk))
+                         && disk_has_write_cache(disk)
+                         && unflushed_writes[disk] > 0;
+        if (flushing[disk]) {
+            submit_disk_request(&requests[disk], disk, 0, NULL, DISK_FLUSH, current_PCB, disk_waiters[disk]);
+            cache_flushes++;
+        }
+    }
+
+    // the interrupt handler lets us go under the disk lock, so we can't miss it
+    for (disk = 1; disk <= MAX_NUMBER_OF_DISKS; disk++) {
+        while (flushing[disk] && !requests[disk].done) {
+            wait_queue_add(disk_waiters[disk], current_PCB);
+            unlock_disk();
+            give_up_cpu();
+            lock_disk();
+        }
+    }
+    unlock_disk();
+}
+
+/************************************************************************
+    BUFFER CACHE
+        DISK_READ and DISK_WRITE go through a cache of sectors, so a
+        sector read or written lately comes back without going to the
+        disk.  A write only goes as far as its buffer, which is written
+        back when the buffer is taken for another sector, or by the
+        flush daemon.  Nobody else touches a buffer while it is being
+        filled or written back; anybody who wants it waits until it is
+        done.  The one exception is DISK_WRITE to a buffer a flush is
+        writing back, which goes straight in.  Swap traffic goes around
+        the cache, since pages have frames of their own.
+************************************************************************/
+
+/**
+* Waits for somebody to finish with a buffer
+*/
+static void wait_for_buffer(void) {
+    wait_queue_add(buffer_waiters, current_PCB);
+    give_up_cpu();
+}
+
+/**
+* Lets go of a buffer, and wakes whoever was waiting for one
+*/
+static void release_buffer(CACHE_BUFFER* b) {
+    b->busy = FALSE;
+    wait_queue_wake_all(buffer_waiters);
+}
+
+/**
+* Returns the buffer for a sector, busy so nobody else touches it until
+* it is released.  If the sector isn't cached the least recently used
+* buffer is taken for it, and holds nothing valid yet.  A dirty buffer
+* has to be written back before it can be taken, and anything may have
+* changed by the time that is done, so we look again from the start.
+*/
+static CACHE_BUFFER* get_buffer(long disk_id, long sector_id) {
+    CACHE_BUFFER* b;
+
+    while (TRUE) {
+        b = buffer_cache_lookup(buffer_cache, disk_id, sector_id);
+        if (b == NULL) {
+            b = buffer_cache_victim(buffer_cache);
+            if (b == NULL) {
+                wait_for_buffer();
+                continue;
+            }
+
+            if (b->dirty) {
+                b->busy = TRUE;
+                disk_write(b->disk_id, b->sector_id, b->data);
+                b->dirty = FALSE;
+                cache_writebacks++;
+                release_buffer(b);
+                continue;
+            }
+            buffer_cache_assign(buffer_cache, b, disk_id, sector_id);
+        }
+        else if (b->busy) {
+            wait_for_buffer();
+            continue;
+        }
 
-        // suspend the process until we can finish writing
-        current_PCB->state = SUSPEND;
-        current_PCB->suspend_reason = WAITING_FOR_DISK;
-        switch_context(root_process_pcb, SWITCH_CONTEXT_SAVE_MODE);
+        b->busy = TRUE;
+        buffer_cache_touch(buffer_cache, b);
+        return b;
+    }
+}
+
+/**
+* Reads a sector through the buffer cache.  A hit is copied straight
+* out, without going near the disk.
+*/
+void cached_disk_read(long disk_id, long sector_id, char* read_buffer) {
+    CACHE_BUFFER* b;
+
+    if (buffer_cache == NULL) {
+        disk_read(disk_id, sector_id, read_buffer);
+        return;
+    }
+
+    b = get_buffer(disk_id, sector_id);
+    if (b->valid)
+        cache_hits++;
+    else {
+        cache_misses++;
+        disk_read(disk_id, sector_id, b->data);
+        b->valid = TRUE;
+    }
+    memcpy(read_buffer, b->data, PGSIZE);
+    release_buffer(b);
+}
+
+/**
+* Writes a sector into the buffer cache.  A sector written again before
+* it gets to the disk only goes once.  It gets there when the flush
+* daemon comes round, when its buffer is taken for another sector, or
+* when somebody calls FLUSH_DISK.
+*/
+void cached_disk_write(long disk_id, long sector_id, char* write_buffer) {
+    CACHE_BUFFER* b;
+    INT32 start_time;
+    INT32 end_time;
+
+    MEM_READ(Z502ClockStatus, &start_time);
+    disk_write_calls++;
+
+    if (buffer_cache == NULL)
+        disk_write(disk_id, sector_id, write_buffer);
+    else if ((b = buffer_cache_lookup(buffer_cache, disk_id, sector_id)) != NULL && b->flushed_by != NULL) {
+        // The disk takes its own copy when the write back starts, so we
+        // can't spoil it.  Whatever doesn't make it waits for the next flush.
+        lock_disk();
+        memcpy(b->data, write_buffer, PGSIZE);
+        b->rewritten = TRUE;
+        buffer_cache_touch(buffer_cache, b);
+        unlock_disk();
+    }
+    else {
+        b = get_buffer(disk_id, sector_id);
+        if (b->dirty)
+            writes_merged++;
+        memcpy(b->data, write_buffer, PGSIZE);
+        b->valid = TRUE;
+        b->dirty = TRUE;
+        release_buffer(b);
+        wake_flush_daemon();
+    }
+
+    MEM_READ(Z502ClockStatus, &end_time);
+    write_stall_total += end_time - start_time;
+}
+
+/**
+* Keeps the buffer cache in step with a transfer that goes around it.
+* A read of a sector the cache holds is copied out of the cache, and
+* TRUE is returned, since the disk needn't be asked.  A write to one is
+* copied into the cache as well.
+*/
+static BOOL cache_around(long disk_id, long sector_id, char* buffer, int operation) {
+    CACHE_BUFFER* b;
+
+    if (buffer_cache == NULL || buffer_cache_lookup(buffer_cache, disk_id, sector_id) == NULL)
+        return FALSE;
+
+    b = get_buffer(disk_id, sector_id);
+    if (operation == DISK_READ && b->valid) {
+        memcpy(buffer, b->data, PGSIZE);
+        release_buffer(b);
+        return TRUE;
+    }
+    if (operation == DISK_WRITE) {
+        memcpy(b->data, buffer, PGSIZE);
+        b->valid = TRUE;
+    }
+    release_buffer(b);
+    return FALSE;
+}
+
+/**
+* Writes back every dirty buffer of a disk, or of every disk if disk_id
+* is -1, and waits until they are on the disk.  operation is DISK_WRITE,
+* or DISK_WRITE_FUA to have them go past the disks' write caches.  They
+* all go at once, so the disk scheduling policy can put them in order.
+* Buffers somebody else is busy with are waited for and looked at again.
+* Returns how many buffers we wrote.
+*/
+INT32 flush_buffers(long disk_id, int operation) {
+    CACHE_BUFFER* b;
+    INT32 written = 0;
+    BOOL busy;
+    INT32 i;
+
+    if (buffer_cache == NULL)
+        return 0;
+
+    do {
+        busy = FALSE;
+
+        lock_disk();
+        for (i = 0; i < buffer_cache->buffer_count; i++) {
+            b = &buffer_cache->buffers[i];
+            if (!b->dirty || (disk_id != -1 && b->disk_id != disk_id))
+                continue;
+            if (b->busy) {
+                busy = TRUE;
+                continue;
+            }
+
+            b->busy = TRUE;
+            b->flushed_by = current_PCB;
+            submit_block_request(&b->request, b->disk_id, b->sector_id, b->data, operation,
+                                 current_PCB, disk_waiters[b->disk_id]);
+        }
+
+        // the interrupt handler lets us go under the disk lock, so we can't miss it
+        for (i = 0; i < buffer_cache->buffer_count; i++) {
+            b = &buffer_cache->buffers[i];
+            if (b->flushed_by != current_PCB)
+                continue;
+
+            while (!b->request.done) {
+                wait_queue_add(disk_waiters[b->disk_id], current_PCB);
+                unlock_disk();
+                give_up_cpu();
+                lock_disk();
+            }
+            b->flushed_by = NULL;
+            b->dirty = b->rewritten;
+            b->rewritten = FALSE;
+            b->busy = FALSE;
+            written++;
+        }
+        unlock_disk();
+        wait_queue_wake_all(buffer_waiters);
+
+        if (busy)
+            wait_for_buffer();
+    } while (busy);
+
+    return written;
+}
+
+/**
+* Starts the flush daemon if it isn't running yet.  Returns FALSE if it can't be.
+*/
+static BOOL start_flush_daemon(void) {
+    INT32 error;
+
+    if (flush_pcb != NULL)
+        return TRUE;
+
+    flush_pcb = os_make_process("flush", FLUSH_PRIORITY, &error, (void*) flush_daemon, KERNEL_MODE);
+    if (flush_pcb == NULL)
+        return FALSE;
+
+    // it belongs to the OS, not to whoever happened to write
+    flush_pcb->parent = root_process_pcb->pid;
+    return TRUE;
+}
+
+/**
+* Called whenever a buffer is written to.  Starts the flush daemon the
+* first time, and wakes it if it is idle.  Once too many buffers are
+* dirty it goes right away, instead of waiting out its interval.
+*/
+void wake_flush_daemon(void) {
+    if (!start_flush_daemon())
+        return;
+
+    wait_queue_wake(flush_idle_waiters, flush_pcb);
+
+    if (buffer_cache_dirty_count(buffer_cache) * FLUSH_DIRTY_SHARE >= buffer_cache->buffer_count) {
+        lock_timer();
+        if (flush_pcb->state == SLEEPING && timer_wheel_remove(timer_queue, flush_pcb) != NULL)
+            flush_pcb->state = READY;
+        unlock_timer();
+    }
+}
+
+/**
+* What the flush daemon runs.  Every flush_interval ticks it writes back
+* whatever is dirty, and sleeps while nothing is.
+*/
+void flush_daemon(void) {
+    while (TRUE) {
+        if (buffer_cache_dirty_count(buffer_cache) == 0) {
+            wait_queue_add(flush_idle_waiters, current_PCB);
+            give_up_cpu();
+            continue;
+        }
+
+        // give writes to the same sectors a while to pile up
+        sleep_process(flush_interval, current_PCB);
+        give_up_cpu();
+        flush_writes += flush_buffers(-1, DISK_WRITE);
+    }
+}
+
+/************************************************************************
+    ASYNCHRONOUS DISK I/O
+        DISK_READ_ASYNC and DISK_WRITE_ASYNC hand a transfer to its disk
+        and come straight back with a handle, so one process can keep
+        every disk busy at once, or get on with something while they
+        work.  It picks them up again with DISK_WAIT, DISK_WAIT_ANY or
+        DISK_POLL, or asks to be told through its mailbox instead, as a
+        message from itself.  They go around the buffer cache, except
+        that a read of a sector the cache holds is answered from it, and
+        a write to one is copied into it, so neither goes stale.
+************************************************************************/
+
+/**
+* Starts a transfer for the current process without waiting for it.
+* Returns its handle, or -1 with error set if the process has too many
+* going already.  buffer has to stay put until the transfer is done.
+*/
+INT32 start_async_io(long disk_id, long sector_id, char* buffer, int operation, BOOL notify, INT32* error) {
+    DISK_REQUEST* request;
+    INT32 handle;
+
+    for (handle = 0; handle < MAX_ASYNC_IO; handle++) {
+        if (current_PCB->async_io[handle] == NULL)
+            break;
+    }
+    if (handle == MAX_ASYNC_IO) {
+        *error = ERR_BAD_PARAM;
+        return -1;
+    }
+
+    request = (DISK_REQUEST*) calloc(1, sizeof(DISK_REQUEST));
+    request->notify = notify;
+    current_PCB->async_io[handle] = request;
+    async_requests++;
+    *error = ERR_SUCCESS;
+
+    if (cache_around(disk_id, sector_id, buffer, operation)) {
+        async_cache_hits++;
+
+        // done already, without going near the disk
+        request->disk_id = disk_id;
+        request->sector_id = sector_id;
+        request->operation = operation;
+        request->waiter = current_PCB;
+        request->done = TRUE;
+        if (notify) {
+            lock_disk();
+            post_async_completions(current_PCB);
+            unlock_disk();
+        }
+        return handle;
+    }
+
+    lock_disk();
+    submit_block_request(request, disk_id, sector_id, buffer, operation, current_PCB,
+                         notify ? message_waiters : async_waiters);
+    unlock_disk();
+    return handle;
+}
+
+/**
+* Waits for one of the current process's transfers to be done, and lets
+* go of its handle.  Returns FALSE if there is no such transfer, or it
+* is reported through the mailbox instead.
+*/
+BOOL wait_async_io(INT32 handle) {
+    DISK_REQUEST* request;
+
+    if (handle < 0 || handle >= MAX_ASYNC_IO)
+        return FALSE;
+    request = current_PCB->async_io[handle];
+    if (request == NULL || request->notify)
+        return FALSE;
+
+    // the interrupt handler lets us go under the disk lock, so we can't miss it
+    lock_disk();
+    while (!request->done) {
+        wait_queue_add(async_waiters, current_PCB);
+        unlock_disk();
+        give_up_cpu();
+        lock_disk();
+    }
+    unlock_disk();
+
+    current_PCB->async_io[handle] = NULL;
+    free(request);
+    return TRUE;
+}
+
+/**
+* Waits for whichever of the current process's transfers is done first,
+* lets go of it and returns its handle.  Returns -1 if it has nothing
+* going that isn't reported through the mailbox.
+*/
+INT32 wait_any_async_io(void) {
+    DISK_REQUEST* request;
+    BOOL going;
+    INT32 handle;
+
+    lock_disk();
+    while (TRUE) {
+        going = FALSE;
+        for (handle = 0; handle < MAX_ASYNC_IO; handle++) {
+            request = current_PCB->async_io[handle];
+            if (request == NULL || request->notify)
+                continue;
+            if (request->done)
+                break;
+            going = TRUE;
+        }
+        if (handle < MAX_ASYNC_IO || !going)
+            break;
+
+        wait_queue_add(async_waiters, current_PCB);
+        unlock_disk();
+        give_up_cpu();
+        lock_disk();
+    }
+    unlock_disk();
+
+    if (handle == MAX_ASYNC_IO)
+        return -1;
+    free(current_PCB->async_io[handle]);
+    current_PCB->async_io[handle] = NULL;
+    return handle;
+}
+
+/**
+* Turns a process's finished transfers that asked to be told into
+* messages from itself.  Each holds the handle, disk, sector and
+* operation, as INT32s.  The interrupt handler calls this as each one
+* finishes.  Whatever doesn't fit in the mailbox is left for
+* RECEIVE_MESSAGE to post.  The caller holds the disk lock.
+*/
+void post_async_completions(PCB* pcb) {
+    DISK_REQUEST* request;
+    MESSAGE* msg;
+    INT32 completion[4];
+    INT32 handle;
+
+    for (handle = 0; handle < MAX_ASYNC_IO; handle++) {
+        request = pcb->async_io[handle];
+        if (request == NULL || !request->notify || !request->done)
+            continue;
+
+        completion[0] = handle;
+        completion[1] = request->disk_id;
+        completion[2] = request->sector_id;
+        completion[3] = request->operation;
+
+        msg = (MESSAGE*) calloc(1, sizeof(MESSAGE));
+        msg->source_pid = pcb->pid;
+        msg->length = sizeof(completion);
+        memcpy(msg->msg_buffer, completion, sizeof(completion));
+        if (!enqueue_message(pcb, msg)) {
+            free(msg);
+            return;
+        }
+
+        pcb->async_io[handle] = NULL;
+        free(request);
+        async_messages++;
+    }
+}
+
+/**
+* Lets go of whatever a process that is going away still has going.
+* What is still waiting for its disk is called off, and what a disk is
+* working on frees itself once it is done.
+*/
+void abandon_async_io(PCB* pcb) {
+    DISK_REQUEST* request;
+    INT32 handle;
+
+    lock_disk();
+    for (handle = 0; handle < MAX_ASYNC_IO; handle++) {
+        request = pcb->async_io[handle];
+        if (request == NULL)
+            continue;
+
+        // one on a volume may be in pieces anywhere, so it is left to finish
+        if (request->done || (find_volume(request->disk_id) == NULL
+                              && disk_queue_remove(disk_queue[request->disk_id], request)))
+            free(request);
+        else
+            request->abandoned = TRUE;
+        pcb->async_io[handle] = NULL;
+    }
+    unlock_disk();
+}
+
+/************************************************************************
+    VECTORED DISK I/O
+        DISK_READV and DISK_WRITEV move a list of sectors in one call.
+        They go to their disks all at once, in disk and sector order, so
+        every disk works on its share at the same time with the whole of
+        it in front of its scheduling policy.  The caller is woken once
+        the last one is done.  The buffer cache is kept in step the same
+        way as for asynchronous transfers.
+************************************************************************/
+
+/**
+* Orders segments by disk, then sector, then where they are in the
+* list, so the later of two writes to a sector is the one that sticks
+*/
+static int compare_segments(const void* a, const void* b) {
+    DISK_SEGMENT* first = *(DISK_SEGMENT**) a;
+    DISK_SEGMENT* second = *(DISK_SEGMENT**) b;
+
+    if (first->disk_id != second->disk_id)
+        return first->disk_id < second->disk_id ? -1 : 1;
+    if (first->sector_id != second->sector_id)
+        return first->sector_id < second->sector_id ? -1 : 1;
+    return first < second ? -1 : (first > second);
+}
+
+/**
+* Moves every segment in the list, and returns once they are all done.
+* The caller has made sure there are no more than MAX_DISK_SEGMENTS, and
+* that they are all on real disks and sectors.
+*/
+void disk_transfer_vector(DISK_SEGMENT* segments, INT32 count, int operation) {
+    DISK_SEGMENT* order[MAX_DISK_SEGMENTS];
+    DISK_REQUEST requests[MAX_DISK_SEGMENTS];
+    INT32 submitted = 0;
+    INT32 i;
+
+    for (i = 0; i < count; i++)
+        order[i] = &segments[i];
+    qsort(order, count, sizeof(DISK_SEGMENT*), compare_segments);
+
+    // the cache may make us wait for a buffer, so it goes before the disk lock
+    for (i = 0; i < count; i++) {
+        if (cache_around(order[i]->disk_id, order[i]->sector_id, order[i]->buffer, operation)) {
+            vector_cache_hits++;
+            order[i] = NULL;
+        }
+    }
+
+    lock_disk();
+    for (i = 0; i < count; i++) {
+        if (order[i] == NULL)
+            continue;
+        submit_block_request(&requests[submitted], order[i]->disk_id, order[i]->sector_id,
+                             order[i]->buffer, operation, current_PCB, vector_waiters);
+        submitted++;
+    }
+
+    // the interrupt handler lets us go under the disk lock, so we can't miss it
+    for (i = 0; i < submitted; i++) {
+        while (!requests[i].done) {
+            wait_queue_add(vector_waiters, current_PCB);
+            unlock_disk();
+            give_up_cpu();
+            lock_disk();
+        }
+    }
+    unlock_disk();
+}
+
+/************************************************************************
+    READ-AHEAD
+        A process that faults its way through memory in steps of the same
+        size is likely to keep going.  Once it has faulted
+        READAHEAD_TRIGGER times in a row the same distance apart, the next
+        few pages in that direction that are out on swap are read into
+        free frames while it gets on with the page it faulted on.  Nobody
+        waits for those reads.  The page-out daemon maps each page in when
+        its read finishes, valid but not referenced, so the replacement
+        policy takes it first if it goes unused.  How far a process reads
+        ahead grows as those pages get used and is halved each time one is
+        evicted without having been.
+************************************************************************/
+
+/**
+* Counts the pages read ahead for a process that it has used since
+*/
+static void resolve_prefetches(PCB* pcb) {
+    INT32 page_id;
+    INT32 i;
+
+    // going backwards, the page moved into a resolved one's place has been looked at already
+    for (i = pcb->prefetch_pending - 1; i >= 0; i--) {
+        page_id = pcb->prefetch_pages[i];
+        if (pcb->shadow_table[page_id].frame_id == -1
+                && (pcb->pagetable[page_id] & (PTBL_REFERENCED_BIT | PTBL_MODIFIED_BIT)))
+            prefetch_resolved(pcb, page_id, TRUE);
+    }
+}
+
+/**
+* Starts reading a page of the current process in from swap without
+* waiting for it.  Returns FALSE if there is no frame to spare for it,
+* or its disk is busy; a guess isn't worth waiting for.
+*/
+static BOOL start_prefetch(INT32 page_id) {
+    SHADOW_TABLE* entry = &current_PCB->shadow_table[page_id];
+    INT32 home_disk = block_home_disk(entry->disk_id, entry->sector_id);
+    PAGER_IO* io = &pager_io[home_disk];
+    INT32 frame;
+
+    // the frames the daemon keeps free are there for faults
+    if (frame_bitmap_free_count(free_frames) <= free_frames_low)
+        return FALSE;
+    if (current_PCB->max_resident > 0 && current_PCB->resident_pages >= current_PCB->max_resident)
+        return FALSE;
+    if (current_PCB->prefetch_pending >= MAX_PREFETCH_PENDING)
+        return FALSE;
+    if (!start_pageout_daemon())
+        return FALSE;
+
+    lock_disk();
+    if (io->busy || !disk_idle(home_disk)) {
+        unlock_disk();
+        return FALSE;
     }
-    else if(disk_status == DEVICE_IN_USE) {
-        printf("Error, disk should not already be in use!\n");
+
+    frame = find_empty_frame(page_id);
+    if (frame == -1) {
+        unlock_disk();
+        return FALSE;
     }
+
+    // nobody may take the frame until the page is in it
+    frame_list[frame].locked = TRUE;
+    entry->frame_id = frame;
+    entry->prefetched = TRUE;
+    current_PCB->prefetch_pages[current_PCB->prefetch_pending++] = page_id;
+
+    io->busy = TRUE;
+    io->operation = DISK_READ;
+    io->frame = frame;
+    io->pid = current_PCB->pid;
+    io->page_id = page_id;
+    io->slot = *entry;
+    readaheads_in_flight++;
+    prefetches++;
+
+    submit_block_request(&io->request, entry->disk_id, entry->sector_id, io->buffer, DISK_READ,
+                         pageout_pcb, pageout_io_waiters);
+
+    // the daemon may be idle, and has to be waiting on its transfers to hear this one finish
+    wait_queue_wake(pageout_idle_waiters, pageout_pcb);
+    unlock_disk();
+    return TRUE;
+}
+
+/**
+* Called on every page fault.  Works out whether the current process is
+* faulting its way through memory, and if it is, starts reading in the
+* pages it is headed for.  Pages that were never paged out cost a fault
+* but no disk time, so they are stepped over.
+*/
+void read_ahead(INT32 page_id) {
+    PCB* pcb = current_PCB;
+    INT32 stride = page_id - pcb->last_fault_page;
+    INT32 started = 0;
+    INT32 next;
+
+    resolve_prefetches(pcb);
+
+    // a fault where the stream was headed keeps it going, anything else may start a new one
+    if (pcb->stream_length > 0 && (stride == pcb->fault_stride || page_id == pcb->readahead_next))
+        pcb->stream_length++;
     else {
-        printf("Catch All from disk_write! Should never get here!\n");
+        pcb->fault_stride = stride;
+        if (pcb->last_fault_page != -1 && stride != 0 && abs(stride) <= READAHEAD_MAX_STRIDE)
+            pcb->stream_length = 1;
+        else
+            pcb->stream_length = 0;
+
+        // a new stream gets another try, even if the last one wasted what was read for it
+        if (pcb->readahead_window == 0)
+            pcb->readahead_window = 1;
+    }
+    pcb->last_fault_page = page_id;
+    pcb->readahead_next = -1;
+
+    if (readahead_max == 0 || pcb->shadow_table == NULL || pcb->stream_length < READAHEAD_TRIGGER)
+        return;
+
+    for (next = page_id + pcb->fault_stride; next >= 0 && next < VIRTUAL_MEM_PGS
+            && started < pcb->readahead_window; next += pcb->fault_stride) {
+        if (!pcb->shadow_table[next].in_use || pcb->shadow_table[next].frame_id != -1
+                || (pcb->pagetable[next] & PTBL_VALID_BIT))
+            continue;
+        if (!start_prefetch(next))
+            break;
+        started++;
+    }
+    pcb->readahead_next = next;
+}
+
+/**
+* Puts a page that was read ahead into its frame.  Its owner may have
+* gone away in the meantime and left the frame and the sector to us.
+*/
+static void finish_prefetch(PAGER_IO* io) {
+    PCB* owner = find_process(io->pid);
+    INT32 current_time;
+
+    if (owner == NULL) {
+        free_frame(io->frame);
+        free_swap_slot(&io->slot);
+        return;
+    }
+
+    Z502WritePhysicalMemory(io->frame, io->buffer);
+    MEM_READ(Z502ClockStatus, &current_time);
+    frame_list[io->frame].last_used = process_virtual_time(io->pid, current_time);
+    frame_list[io->frame].prefetched = TRUE;
+    owner->pagetable[io->page_id] = (UINT16) frame_list[io->frame].frame_id | PTBL_VALID_BIT;
+    owner->shadow_table[io->page_id].frame_id = -1;
+    frame_list[io->frame].locked = FALSE;
+    frame_available();
+    wait_queue_wake(page_waiters, owner);
+}
+
+/************************************************************************
+    PAGE-OUT DAEMON
+        A kernel process that keeps a few frames free, so a page fault can
+        usually take one straight away instead of waiting for a victim to
+        be written out.  It is started the first time free frames drop
+        below free_frames_low and frees frames until there are
+        free_frames_high of them.  Clean victims are freed on the spot.
+        Dirty ones are written out with one write going per disk, and the
+        frame is freed once the interrupt handler says the write is done.
+        It also sees to the reads started by read_ahead.
+************************************************************************/
+
+/**
+* Starts the daemon if it isn't running yet.  Returns FALSE if it can't be.
+*/
+BOOL start_pageout_daemon(void) {
+    INT32 error;
+
+    if (pageout_pcb != NULL)
+        return TRUE;
+
+    pageout_pcb = os_make_process("pageout", PAGEOUT_PRIORITY, &error, (void*) pageout_daemon, KERNEL_MODE);
+    if (pageout_pcb == NULL)
+        return FALSE;
+
+    // it belongs to the OS, not to whoever happened to fault
+    pageout_pcb->parent = root_process_pcb->pid;
+    return TRUE;
+}
+
+/**
+* Starts the daemon the first time memory runs low, and wakes it up
+* after that whenever it has gone back to sleep
+*/
+void wake_pageout_daemon(void) {
+    if (!pageout_enabled || frame_bitmap_free_count(free_frames) >= free_frames_low)
+        return;
+
+    if (pageout_pcb == NULL) {
+        if (!start_pageout_daemon())
+            pageout_enabled = FALSE;
+        return;
+    }
+
+    wait_queue_wake(pageout_idle_waiters, pageout_pcb);
+}
+
+/**
+* TRUE if the daemon's transfer on a disk is done.  The interrupt handler
+* marks it done when the transfer finishes.
+*/
+static BOOL pager_io_done(INT32 disk_id) {
+    return pager_io[disk_id].busy && pager_io[disk_id].request.done;
+}
+
+/**
+* Frees the frames whose writes have finished, and maps in the pages
+* whose reads ahead have
+*/
+static void reap_pager_io(void) {
+    INT32 disk_id;
+
+    for (disk_id = 1; disk_id <= MAX_NUMBER_OF_DISKS; disk_id++) {
+        if (!pager_io_done(disk_id))
+            continue;
+
+        if (pager_io[disk_id].operation == DISK_WRITE) {
+            swap_write_done(pager_io[disk_id].pid, pager_io[disk_id].page_id, &pager_io[disk_id].slot);
+            free_frame(pager_io[disk_id].frame);
+            cleans_in_flight--;
+        }
+        else {
+            finish_prefetch(&pager_io[disk_id]);
+            readaheads_in_flight--;
+        }
+        pager_io[disk_id].busy = FALSE;
+    }
+}
+
+/**
+* Blocks until one of the daemon's transfers finishes.  Returns straight
+* away if one already has, or if it has none going.
+*/
+static void pageout_wait(void) {
+    INT32 disk_id;
+
+    // the interrupt handler lets us go under the disk lock, so we can't miss it
+    lock_disk();
+    for (disk_id = 1; disk_id <= MAX_NUMBER_OF_DISKS; disk_id++) {
+        if (pager_io_done(disk_id)) {
+            unlock_disk();
+            return;
+        }
+    }
+
+    if (cleans_in_flight + readaheads_in_flight == 0) {
+        unlock_disk();
+        return;
+    }
+
+    wait_queue_add(pageout_io_waiters, current_PCB);
+    unlock_disk();
+    give_up_cpu();
+}
+
+/**
+* Frees one frame the replacement policy picks.  Returns FALSE if it
+* had nothing to give.
+*/
+static BOOL pageout_one(void) {
+    INT32 current_time;
+    INT32 victim;
+    SHADOW_TABLE slot;
+    PAGER_IO* io;
+
+    MEM_READ(Z502ClockStatus, &current_time);
+    victim = pager->choose_victim(frame_list, phys_mem_pgs, -1, current_time, ws_window);
+    if (victim == -1)
+        return FALSE;
+
+    frame_list[victim].locked = TRUE;
+    pageout_frames++;
+
+    if (!unmap_frame(victim) || !reserve_swap_slot(victim, &slot)) {
+        free_frame(victim);
+        return TRUE;
+    }
+
+    // one transfer per disk, seeing to whatever finishes in the meantime
+    io = &pager_io[block_home_disk(slot.disk_id, slot.sector_id)];
+    reap_pager_io();
+    while (io->busy) {
+        pageout_wait();
+        reap_pager_io();
+    }
+
+    // the disk takes a copy when the write starts, which may not be straight away
+    Z502ReadPhysicalMemory(victim, io->buffer);
+
+    io->busy = TRUE;
+    io->operation = DISK_WRITE;
+    io->frame = victim;
+    io->pid = frame_list[victim].pid;
+    io->page_id = frame_list[victim].page_id;
+    io->slot = slot;
+    cleans_in_flight++;
+    pageout_writes++;
+
+    lock_disk();
+    submit_block_request(&io->request, slot.disk_id, slot.sector_id, io->buffer, DISK_WRITE,
+                         pageout_pcb, pageout_io_waiters);
+    unlock_disk();
+    return TRUE;
+}
+
+/**
+* What the daemon runs.  It never ends; the OS halts around it.
+*/
+void pageout_daemon(void) {
+    INT32 disk_id;
+    BOOL done;
+
+    while (TRUE) {
+        reap_pager_io();
+
+        while (pageout_enabled && frame_bitmap_free_count(free_frames) + cleans_in_flight < free_frames_high) {
+            if (!pageout_one())
+                break;
+        }
+
+        // sleep until a transfer finishes, or until somebody runs low on frames again
+        lock_disk();
+        done = FALSE;
+        for (disk_id = 1; disk_id <= MAX_NUMBER_OF_DISKS; disk_id++)
+            done = done || pager_io_done(disk_id);
+
+        if (!done) {
+            wait_queue_add(cleans_in_flight + readaheads_in_flight > 0 ? pageout_io_waiters : pageout_idle_waiters,
+                           current_PCB);
+        }
+        unlock_disk();
+        give_up_cpu();
     }
 }
\ No newline at end of file
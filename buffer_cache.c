@@ -0,0 +1,129 @@
+#include "buffer_cache.h"
+
+/**
+* Unlinks a buffer from the use order
+*/
+static void lru_unlink(BufferCache c, CACHE_BUFFER* b) {
+    if (b->lru_prev != NULL)
+        b->lru_prev->lru_next = b->lru_next;
+    else
+        c->most_recent = b->lru_next;
+    if (b->lru_next != NULL)
+        b->lru_next->lru_prev = b->lru_prev;
+    else
+        c->least_recent = b->lru_prev;
+    b->lru_prev = NULL;
+    b->lru_next = NULL;
+}
+
+/**
+* Puts a buffer at the most recently used end
+*/
+static void lru_push(BufferCache c, CACHE_BUFFER* b) {
+    b->lru_prev = NULL;
+    b->lru_next = c->most_recent;
+    if (c->most_recent != NULL)
+        c->most_recent->lru_prev = b;
+    c->most_recent = b;
+    if (c->least_recent == NULL)
+        c->least_recent = b;
+}
+
+/**
+* Returns a cache of buffer_count empty buffers
+*/
+BufferCache create_buffer_cache(INT32 buffer_count) {
+    BufferCache c = (BufferCache) calloc(1, sizeof(BufferCacheData));
+    INT32 i;
+
+    // In case we are out of memory, or something crazy happens...
+    if (c == NULL) {
+        printf("Could not create buffer cache...");
+        return NULL;
+    }
+
+    c->buffers = (CACHE_BUFFER*) calloc(buffer_count, sizeof(CACHE_BUFFER));
+    c->buffer_count = buffer_count;
+    c->most_recent = NULL;
+    c->least_recent = NULL;
+
+    for (i = 0; i < buffer_count; i++) {
+        c->buffers[i].disk_id = -1;
+        c->buffers[i].sector_id = -1;
+        lru_push(c, &c->buffers[i]);
+    }
+    return c;
+}
+
+/**
+* Returns the buffer holding a sector, or NULL if none does
+*/
+CACHE_BUFFER* buffer_cache_lookup(BufferCache c, INT32 disk_id, INT32 sector_id) {
+    CACHE_BUFFER* b;
+
+    for (b = c->hash[BUFFER_CACHE_HASH(disk_id, sector_id)]; b != NULL; b = b->hash_next) {
+        if (b->disk_id == disk_id && b->sector_id == sector_id)
+            return b;
+    }
+    return NULL;
+}
+
+/**
+* The least recently used buffer nobody is busy with, or NULL if they
+* all are.  It may be dirty.
+*/
+CACHE_BUFFER* buffer_cache_victim(BufferCache c) {
+    CACHE_BUFFER* b;
+
+    for (b = c->least_recent; b != NULL; b = b->lru_prev) {
+        if (!b->busy)
+            return b;
+    }
+    return NULL;
+}
+
+/**
+* Hands a buffer over to another sector.  It holds nothing valid until
+* somebody fills it.
+*/
+void buffer_cache_assign(BufferCache c, CACHE_BUFFER* b, INT32 disk_id, INT32 sector_id) {
+    CACHE_BUFFER** link;
+
+    if (b->disk_id != -1) {
+        link = &c->hash[BUFFER_CACHE_HASH(b->disk_id, b->sector_id)];
+        while (*link != b)
+            link = &(*link)->hash_next;
+        *link = b->hash_next;
+    }
+
+    b->disk_id = disk_id;
+    b->sector_id = sector_id;
+    b->valid = FALSE;
+    b->dirty = FALSE;
+    b->hash_next = c->hash[BUFFER_CACHE_HASH(disk_id, sector_id)];
+    c->hash[BUFFER_CACHE_HASH(disk_id, sector_id)] = b;
+}
+
+/**
+* A buffer has just been used, so it is the last one to be taken
+*/
+void buffer_cache_touch(BufferCache c, CACHE_BUFFER* b) {
+    lru_unlink(c, b);
+    lru_push(c, b);
+}
+
+/**
+* Return the number of buffers waiting to be written back
+*/
+INT32 buffer_cache_dirty_count(BufferCache c) {
+    INT32 dirty = 0;
+    INT32 i;
+
+    if (c == NULL)
+        return 0;
+    for (i = 0; i < c->buffer_count; i++) {
+        if (c->buffers[i].dirty)
+            dirty++;
+    }
+    return dirty;
+}
@@ -0,0 +1,43 @@
+#ifndef BUFFER_CACHE
+#define BUFFER_CACHE
+#include "my_globals.h"
+
+// Buffers are found by disk and sector through a hash table, and are
+// kept in the order they were last used so the least recent one can
+// be taken for another sector
+#define         BUFFER_CACHE_BUCKETS        64
+#define         BUFFER_CACHE_HASH(disk_id, sector_id) \
+                    ((((disk_id) << 11) ^ (sector_id)) & (BUFFER_CACHE_BUCKETS - 1))
+
+typedef struct CacheBuffer {
+    INT32               disk_id;        // -1 while the buffer holds nothing
+    INT32               sector_id;
+    BOOL                valid;          // data is what is on the sector, or newer
+    BOOL                dirty;          // data is newer, and has to be written back
+    BOOL                busy;           // somebody is filling it, or writing it back
+    PCB*                flushed_by;     // who is writing it back for a flush, NULL if nobody
+    BOOL                rewritten;      // written to again during that flush, so still dirty after it
+    DISK_REQUEST        request;        // that write back
+    char                data[PGSIZE];
+    struct CacheBuffer* hash_next;
+    struct CacheBuffer* lru_prev;       // towards the most recently used
+    struct CacheBuffer* lru_next;       // towards the least recently used
+} CACHE_BUFFER;
+
+typedef struct {
+    CACHE_BUFFER*   buffers;
+    INT32           buffer_count;
+    CACHE_BUFFER*   hash[BUFFER_CACHE_BUCKETS];
+    CACHE_BUFFER*   most_recent;
+    CACHE_BUFFER*   least_recent;
+} BufferCacheData, *BufferCache;
+
+// function prototypes
+BufferCache create_buffer_cache(INT32 buffer_count);
+CACHE_BUFFER* buffer_cache_lookup(BufferCache c, INT32 disk_id, INT32 sector_id);
+CACHE_BUFFER* buffer_cache_victim(BufferCache c);
+void buffer_cache_assign(BufferCache c, CACHE_BUFFER* b, INT32 disk_id, INT32 sector_id);
+void buffer_cache_touch(BufferCache c, CACHE_BUFFER* b);
+INT32 buffer_cache_dirty_count(BufferCache c);
+
+#endif
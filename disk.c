@@ -0,0 +1,195 @@
+#include "disk.h"
+#include "string.h"
+
+/**
+* Returns an empty queue for a disk whose head is at sector 0
+*/
+DiskQueue create_disk_queue(void) {
+    DiskQueue q = (DiskQueue) calloc(1, sizeof(DiskQueueData));
+
+    // In case we are out of memory, or something crazy happens...
+    if (q == NULL) {
+        printf("Could not create disk queue...");
+        return NULL;
+    }
+
+    q->first = NULL;
+    q->last = NULL;
+    q->active = NULL;
+    q->depth = 1;
+    return q;
+}
+
+/**
+* Puts a request at the back of the queue
+*/
+void disk_queue_add(DiskQueue q, DISK_REQUEST* request) {
+    request->next = NULL;
+    if (q->last == NULL)
+        q->first = request;
+    else
+        q->last->next = request;
+    q->last = request;
+    q->length++;
+}
+
+/**
+* Takes a request out of the queue, wherever it is.  Returns FALSE if it
+* wasn't waiting there, because the disk has it or is done with it.
+*/
+BOOL disk_queue_remove(DiskQueue q, DISK_REQUEST* request) {
+    DISK_REQUEST* previous = NULL;
+    DISK_REQUEST* cursor;
+
+    for (cursor = q->first; cursor != NULL && cursor != request; cursor = cursor->next)
+        previous = cursor;
+    if (cursor == NULL)
+        return FALSE;
+
+    if (previous == NULL)
+        q->first = request->next;
+    else
+        previous->next = request->next;
+    if (q->last == request)
+        q->last = previous;
+    request->next = NULL;
+    q->length--;
+    return TRUE;
+}
+
+/**
+* Takes the request the policy wants done next off the queue.  The disk
+* works on it from now on, under the tag it is given, and the head goes
+* where it is.  A flush is for the writes queued before it, so it isn't
+* the policy's to move: it goes once it is the oldest waiting, and has
+* no sector for the head to go to.  Returns NULL if nothing is waiting.
+*/
+DISK_REQUEST* disk_queue_next(DiskQueue q, DISK_POLICY* policy) {
+    DISK_REQUEST* request;
+
+    if (q->first == NULL)
+        return NULL;
+
+    if (q->first->operation == DISK_FLUSH)
+        request = q->first;
+    else
+        request = policy->pick_next(q, q->head_sector);
+    disk_queue_remove(q, request);
+    if (request->operation != DISK_FLUSH) {
+        q->seek_distance += abs(request->sector_id - q->head_sector);
+        q->head_sector = request->sector_id;
+    }
+    request->tag = q->next_tag++;
+    request->next = q->active;
+    q->active = request;
+    q->active_count++;
+    return request;
+}
+
+/**
+* TRUE if the disk is working on all it can at once
+*/
+BOOL disk_queue_full(DiskQueue q) {
+    return q->active_count >= q->depth;
+}
+
+/**
+* The disk is done with the transfer it was given under tag.  Returns
+* that request, or NULL if it has nothing by that tag.  A disk working
+* on one thing at a time doesn't have to say which.
+*/
+DISK_REQUEST* disk_queue_finish(DiskQueue q, INT32 tag) {
+    DISK_REQUEST* previous = NULL;
+    DISK_REQUEST* request;
+
+    for (request = q->active; request != NULL; request = request->next) {
+        if (request->tag == tag || (tag == -1 && q->depth == 1))
+            break;
+        previous = request;
+    }
+    if (request == NULL)
+        return NULL;
+
+    if (previous == NULL)
+        q->active = request->next;
+    else
+        previous->next = request->next;
+    request->next = NULL;
+    q->active_count--;
+    return request;
+}
+
+/**
+* TRUE if the disk has nothing going and nothing waiting
+*/
+BOOL disk_queue_idle(DiskQueue q) {
+    return q->active == NULL && q->first == NULL;
+}
+
+/************************************************************************
+    First come, first served.
+    Every request waits behind only those that came before it.
+************************************************************************/
+static DISK_REQUEST* fifo_pick_next(DiskQueue q, INT32 head_sector) {
+    return q->first;
+}
+
+/************************************************************************
+    Shortest seek time first.
+    Whatever is closest to the head goes next, oldest first on a tie.
+    It moves the head the least, but a request far from where everyone
+    else is working can wait a long time.
+************************************************************************/
+static DISK_REQUEST* sstf_pick_next(DiskQueue q, INT32 head_sector) {
+    DISK_REQUEST* best = q->first;
+    DISK_REQUEST* cursor;
+
+    for (cursor = q->first; cursor != NULL; cursor = cursor->next) {
+        if (cursor->operation != DISK_FLUSH
+                && abs(cursor->sector_id - head_sector) < abs(best->sector_id - head_sector))
+            best = cursor;
+    }
+    return best;
+}
+
+/************************************************************************
+    Circular SCAN.
+    The head sweeps up the disk taking requests in sector order, then
+    goes back to the lowest request and sweeps up again.  Nobody waits
+    longer than one sweep plus the trip back.
+************************************************************************/
+static DISK_REQUEST* cscan_pick_next(DiskQueue q, INT32 head_sector) {
+    DISK_REQUEST* ahead = NULL;
+    DISK_REQUEST* lowest = q->first;
+    DISK_REQUEST* cursor;
+
+    for (cursor = q->first; cursor != NULL; cursor = cursor->next) {
+        if (cursor->operation == DISK_FLUSH)
+            continue;
+        if (cursor->sector_id >= head_sector && (ahead == NULL || cursor->sector_id < ahead->sector_id))
+            ahead = cursor;
+        if (cursor->sector_id < lowest->sector_id)
+            lowest = cursor;
+    }
+    return ahead != NULL ? ahead : lowest;
+}
+
+static DISK_POLICY policies[] = {
+    { "fifo",  fifo_pick_next },
+    { "sstf",  sstf_pick_next },
+    { "cscan", cscan_pick_next },
+};
+
+/**
+* Look up a disk scheduling policy by the name given on the command line.
+* Returns NULL if there is no policy by that name.
+*/
+DISK_POLICY* find_disk_policy(char* name) {
+    int i;
+
+    for (i = 0; i < (int) (sizeof(policies) / sizeof(policies[0])); i++) {
+        if (strcmp(policies[i].name, name) == 0)
+            return &policies[i];
+    }
+    return NULL;
+}
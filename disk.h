@@ -0,0 +1,41 @@
+#ifndef DISK_QUEUE
+#define DISK_QUEUE
+#include "my_globals.h"
+
+// The transfers waiting for one disk, and the ones it is working on.
+// The disk's head is wherever the last transfer started went; moving it
+// further costs more, so a policy may take the queue out of order.  A
+// spinning disk works on one transfer at a time, a solid state disk on
+// as many as it has channels, and tells them apart by their tags.
+typedef struct {
+    DISK_REQUEST*   first;          // waiting, oldest first
+    DISK_REQUEST*   last;
+    INT32           length;
+    DISK_REQUEST*   active;         // on the disk right now, linked through next, NULL while it is idle
+    INT32           active_count;
+    INT32           depth;          // how many the disk can work on at once
+    INT32           next_tag;
+    INT32           head_sector;
+    long            seek_distance;  // sectors the head has been moved over
+} DiskQueueData, *DiskQueue;
+
+// A disk scheduling policy picks which waiting transfer goes next
+typedef struct {
+    char*   name;
+
+    // the request to start next, with the head at head_sector; never NULL on a queue with anything
+    // in it, and never a flush, which is only asked for when the oldest request isn't one
+    DISK_REQUEST*   (*pick_next)(DiskQueue q, INT32 head_sector);
+} DISK_POLICY;
+
+// function prototypes
+DiskQueue create_disk_queue(void);
+void disk_queue_add(DiskQueue q, DISK_REQUEST* request);
+BOOL disk_queue_remove(DiskQueue q, DISK_REQUEST* request);
+DISK_REQUEST* disk_queue_next(DiskQueue q, DISK_POLICY* policy);
+BOOL disk_queue_full(DiskQueue q);
+DISK_REQUEST* disk_queue_finish(DiskQueue q, INT32 tag);
+BOOL disk_queue_idle(DiskQueue q);
+DISK_POLICY* find_disk_policy(char* name);
+
+#endif
@@ -0,0 +1,99 @@
+#include "frame_bitmap.h"
+
+/**
+* Returns a bitmap with frame_count frames, all of them free
+*/
+FrameBitmap create_frame_bitmap(INT32 frame_count) {
+    FrameBitmap b = (FrameBitmap) calloc(1, sizeof(FrameBitmapData));
+    INT32 i;
+
+    // In case we are out of memory, or something crazy happens...
+    if (b == NULL) {
+        printf("Could not create frame bitmap...");
+        return NULL;
+    }
+
+    b->word_count = (frame_count + FRAME_BITMAP_WORD_BITS - 1) / FRAME_BITMAP_WORD_BITS;
+    b->words = (UINT32*) calloc(b->word_count, sizeof(UINT32));
+    b->frame_count = frame_count;
+    b->free_count = 0;
+    b->hint = 0;
+
+    for (i = 0; i < frame_count; i++)
+        frame_bitmap_free(b, i);
+
+    return b;
+}
+
+/**
+* Index of the lowest set bit of a non zero word
+*/
+static INT32 first_set_bit(UINT32 word) {
+#ifdef __GNUC__
+    return __builtin_ctz(word);
+#else
+    INT32 bit = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/**
+* Takes the lowest numbered free frame, or returns -1 if memory is full.
+* Everything below the hint is known to be in use, so we never rescan it.
+*/
+INT32 frame_bitmap_alloc(FrameBitmap b) {
+    INT32 frame;
+
+    if (b == NULL || b->free_count == 0)
+        return -1;
+
+    while (b->hint < b->word_count && b->words[b->hint] == 0)
+        b->hint++;
+
+    if (b->hint == b->word_count)
+        return -1;
+
+    frame = b->hint * FRAME_BITMAP_WORD_BITS + first_set_bit(b->words[b->hint]);
+    b->words[b->hint] &= ~((UINT32) 1 << (frame % FRAME_BITMAP_WORD_BITS));
+    b->free_count--;
+    return frame;
+}
+
+/**
+* Puts a frame back.  Freeing a frame that is already free does nothing.
+*/
+void frame_bitmap_free(FrameBitmap b, INT32 frame) {
+    INT32 word;
+
+    if (b == NULL || frame < 0 || frame >= b->frame_count || frame_bitmap_is_free(b, frame))
+        return;
+
+    word = frame / FRAME_BITMAP_WORD_BITS;
+    b->words[word] |= (UINT32) 1 << (frame % FRAME_BITMAP_WORD_BITS);
+    b->free_count++;
+
+    if (word < b->hint)
+        b->hint = word;
+}
+
+/**
+* TRUE if nobody owns the frame
+*/
+BOOL frame_bitmap_is_free(FrameBitmap b, INT32 frame) {
+    if (b == NULL || frame < 0 || frame >= b->frame_count)
+        return FALSE;
+    return (b->words[frame / FRAME_BITMAP_WORD_BITS] >> (frame % FRAME_BITMAP_WORD_BITS)) & 1;
+}
+
+/**
+* Return the number of free frames
+*/
+INT32 frame_bitmap_free_count(FrameBitmap b) {
+    if (b == NULL)
+        return 0;
+    return b->free_count;
+}
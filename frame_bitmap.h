@@ -0,0 +1,23 @@
+#ifndef FRAME_BITMAP
+#define FRAME_BITMAP
+#include "my_globals.h"
+
+// One bit per physical frame, set while the frame is free
+#define         FRAME_BITMAP_WORD_BITS      32
+
+typedef struct {
+    UINT32*     words;
+    INT32       word_count;
+    INT32       frame_count;
+    INT32       free_count;     // kept up to date so nobody has to count bits
+    INT32       hint;           // lowest word that might still have a free frame in it
+} FrameBitmapData, *FrameBitmap;
+
+// function prototypes
+FrameBitmap create_frame_bitmap(INT32 frame_count);
+INT32 frame_bitmap_alloc(FrameBitmap b);
+void frame_bitmap_free(FrameBitmap b, INT32 frame);
+BOOL frame_bitmap_is_free(FrameBitmap b, INT32 frame);
+INT32 frame_bitmap_free_count(FrameBitmap b);
+
+#endif
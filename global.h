@@ -60,6 +60,7 @@ typedef         int                             BOOL;
 #define         TRUE                            (BOOL)1
 
 #define         PHYS_MEM_PGS                    (short)64
+#define         MAX_PHYS_MEM_PGS                (short)4096    // physical memory actually built; the OS picks how much to use
 #define         PGSIZE                          (short)16
 #define         PGBITS                          (short)4
 #define         VIRTUAL_MEM_PGS                 1024
@@ -83,12 +84,51 @@ typedef         int                             BOOL;
 #define         PTBL_VALID_BIT                  0x8000
 #define         PTBL_MODIFIED_BIT               0x4000
 #define         PTBL_REFERENCED_BIT             0x2000
+#define         PTBL_READ_ONLY_BIT              0x1000    // a write to the page faults as INVALID_MEMORY
 #define         PTBL_PHYS_PG_NO                 0x0FFF
 
         /*  The maximum number of disks we will support:        */
 
 #define         MAX_NUMBER_OF_DISKS             (short)12
 
+        /*  A disk is spinning unless the OS makes it solid state.
+            A solid state disk has no seek, and works on up to
+            SSD_CHANNELS transfers at once.                     */
+
+#define         DISK_TYPE_SPINNING              (short)0
+#define         DISK_TYPE_SSD                   (short)1
+#define         SSD_CHANNELS                    (short)4
+
+        /*  What Z502DiskSetAction takes.  TRIM forgets the
+            Z502DiskSetCount sectors from the one set, and only
+            a solid state disk does it.  FLUSH finishes once
+            every write in the disk's write cache is on the
+            platter; it needs no sector or buffer.  WRITE_FUA
+            (force unit access) goes past the write cache, and
+            finishes once it is on the platter itself.          */
+
+#define         DISK_ACTION_READ                (short)0
+#define         DISK_ACTION_WRITE               (short)1
+#define         DISK_ACTION_TRIM                (short)2
+#define         DISK_ACTION_FLUSH               (short)3
+#define         DISK_ACTION_WRITE_FUA           (short)4
+
+        /*  A spinning disk can keep the sectors around the last
+            one it read in a track cache of Z502DiskSetCacheSize
+            sectors.  AHEAD keeps those after it, TRACK the whole
+            track it is on, a track being that many sectors.    */
+
+#define         DISK_CACHE_AHEAD                (short)0
+#define         DISK_CACHE_TRACK                (short)1
+
+        /*  A spinning disk can also have a volatile write cache
+            of up to Z502DiskSetWriteCache sectors.  A write is
+            done once it is in there, and goes to the platter
+            in the background; one that finds the cache full
+            waits for a place.                                  */
+
+#define         WRITE_CACHE_MAX                 (short)32
+
 
 /*      These are the memory mapped IO addresses                */
 
@@ -104,7 +144,14 @@ typedef         int                             BOOL;
 #define      Z502DiskSetAction         Z502DiskSetup4+1
 #define      Z502DiskSetup4            Z502DiskStart+1
 #define      Z502DiskStart             Z502DiskStatus+1
-#define      Z502DiskStatus            Z502MEM_MAPPED_MIN+1
+#define      Z502DiskStatus            Z502DiskSetWriteCache+1
+#define      Z502DiskSetWriteCache     Z502DiskSetCacheSize+1
+#define      Z502DiskSetCacheSize      Z502DiskSetCachePolicy+1
+#define      Z502DiskSetCachePolicy    Z502DiskSetType+1
+#define      Z502DiskSetType           Z502DiskSetTag+1
+#define      Z502DiskSetTag            Z502DiskSetCount+1
+#define      Z502DiskSetCount          Z502DiskCompletedTag+1
+#define      Z502DiskCompletedTag      Z502MEM_MAPPED_MIN+1
 #define      Z502MEM_MAPPED_MIN        0x7FF00000
 
 /*  These are the allowable locations for hardware synchronization support */
@@ -261,6 +261,10 @@ LinkedList order_by_priority(LinkedList l) {
                     best_node = cursor;
                 else if (best_node->data->priority > cursor->data->priority)
                     best_node = cursor;
+                // round robin within a priority level: whoever ran longest ago goes first
+                else if (best_node->data->priority == cursor->data->priority &&
+                         best_node->data->last_dispatched > cursor->data->last_dispatched)
+                    best_node = cursor;
             }
             cursor = cursor->next;
         }
@@ -3,7 +3,7 @@
 #include "my_globals.h"
 
 // Define what a linked list and its nodes are
-typedef struct {
+typedef struct Node {
     PCB* data;
     struct Node* next;
 } Node, *LinkedList;
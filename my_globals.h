@@ -25,10 +25,41 @@
 #define         DEFAULT_PRIORITY    50
 #define         MAX_PRIORITY        100
 
+// SCHEDULER DEFAULTS
+#define         DEFAULT_QUANTUM     0           // ticks a process may run before it is preempted, 0 is off until -quantum= is given
+
+// PAGER DEFAULTS
+#define         DEFAULT_WS_WINDOW   2000        // ticks of a process's own CPU time a page stays in its working set
+#define         DEFAULT_SWAP_DISKS  4           // disks at the top of the range that hold paged out pages
+#define         PAGEOUT_LOW_SHARE   32          // the page-out daemon wakes when under 1/32 of the frames are free
+#define         PAGEOUT_PRIORITY    MIN_PRIORITY
+#define         DEFAULT_READAHEAD   8           // most pages read ahead of a fault stream, set with -readahead=
+#define         READAHEAD_START     2           // pages read ahead when a stream is first seen
+#define         READAHEAD_TRIGGER   2           // faults in a row the same distance apart before reading ahead
+#define         READAHEAD_MAX_STRIDE 16         // pages apart two faults may be and still be a stream
+#define         MAX_PREFETCH_PENDING 32         // pages a process may have read ahead and not yet used
+
+// DISK DEFAULTS
+#define         DEFAULT_DISK_POLICY "cscan"     // orders each disk's queue, set with -disk_sched=
+#define         DEFAULT_CACHE_BUFFERS 0         // sectors the buffer cache holds, set with -cache_buffers=, 0 is off
+#define         DEFAULT_SSD_DISKS   0           // disks at the top of the range that are solid state, set with -ssd_disks=
+#define         DEFAULT_TRACK_CACHE 0           // sectors each spinning disk keeps in its track cache, set with -track_cache=
+#define         DEFAULT_WRITE_CACHE 0           // writes each spinning disk keeps in its write cache, set with -write_cache=
+#define         DEFAULT_FLUSH_INTERVAL 1000     // ticks a written buffer may stay dirty, set with -flush_interval=
+#define         FLUSH_DIRTY_SHARE   2           // the flush daemon goes early once 1/2 of the buffers are dirty
+#define         FLUSH_PRIORITY      MIN_PRIORITY
+#define         MAX_ASYNC_IO        16          // DISK_READ_ASYNC and DISK_WRITE_ASYNC a process may have going at once
+
+// VOLUME DEFAULTS
+#define         MAX_VOLUMES         8           // volumes answer to the disk numbers after the real disks
+#define         MAX_BLOCK_DEVICES   (MAX_NUMBER_OF_DISKS + MAX_VOLUMES)
+#define         DEFAULT_STRIPE      1           // sectors of a RAID-0 volume on one member at a time, set with -stripe=
+
 // PROCESS SUSPEND REASONS
 #define         WAITING_UNDEFINED   0
 #define         WAITING_FOR_MESSAGE 1
 #define         WAITING_FOR_DISK    2
+#define         WAITING_FOR_FRAMES  3           // the page-out daemon until free frames run low, or a fault until one can be had
 
 // LOCK STATES
 #define         DO_LOCK                     1
@@ -37,6 +68,13 @@
 #define         DO_NOT_SUSPEND              FALSE
 #define         DISK_READ                   1
 #define         DISK_WRITE                  2
+#define         DISK_TRIM                   3
+#define         DISK_FLUSH                  4
+#define         DISK_WRITE_FUA              5
+
+// OS LOCK LOCATIONS (kept above the per-frame locks in the interlock area)
+#define         TIMER_LOCK                  MEMORY_INTERLOCK_BASE + 200
+#define         DISK_LOCK                   MEMORY_INTERLOCK_BASE + 201
 
 typedef struct {
     INT16 msg_buffer[MAX_MSG];
@@ -51,26 +89,77 @@ typedef struct {
     INT32 pid;
     INT32 page_id;
     INT32 frame_id;
+    BOOL locked;        // being written out, so it can't be picked as a victim
+    BOOL prefetched;    // read ahead and not used yet, so the replacement policy passes it over once
+    INT32 sharers;      // page tables it is mapped in; more than one while it is shared copy on write
+    long last_used;     // owner's virtual time when the page was last seen referenced
 } FRAME;
 
+// Where a process's page lives in the swap area
 typedef struct {
     INT32 page_id;
     INT32 disk_id;
     INT32 sector_id;
-    int frame_id;
-    BOOL in_use;
+    int frame_id;       // frame it is being written out from or read ahead into, -1 when it isn't moving
+    BOOL in_use;        // TRUE if the page has a sector of its own
+    BOOL prefetched;    // read ahead of a fault and not yet seen used
 } SHADOW_TABLE;
 
+struct Pcb;
+struct WaitQueueData;
+struct DiskSegment;
+
+// A transfer handed to a disk.  It waits on the disk's queue until the
+// disk scheduling policy picks it, and the interrupt handler marks it
+// done and lets its waiter go when the disk is finished with it.  One
+// on a volume never goes on a queue itself; it is split into a piece
+// for each disk it touches, and is done once they all are.
+typedef struct DiskRequest {
+    INT32               disk_id;
+    INT32               sector_id;
+    char*               buffer;         // the disk copies it when the transfer starts
+    int                 operation;      // DISK_READ, DISK_WRITE, DISK_WRITE_FUA, DISK_TRIM or DISK_FLUSH
+    struct Pcb*         waiter;         // woken when it is done
+    struct WaitQueueData* wait_queue;   // what the waiter sleeps on until then
+    BOOL                done;
+    BOOL                notify;         // the waiter hears it is done through its mailbox
+    BOOL                abandoned;      // its process is gone, so it frees itself once done
+    INT32               queued_at;      // when it was handed to the disk
+    INT32               tag;            // what the disk knows it by while working on it
+    INT32               sector_count;   // how many sectors from sector_id a DISK_TRIM covers
+    struct DiskRequest* parent;         // the transfer on a volume this is a piece of, NULL if there isn't one
+    INT32               pending;        // on a volume, pieces the disks haven't finished yet
+    struct DiskRequest* next;
+} DISK_REQUEST;
+
+// A transfer the page-out daemon looks after on a disk.  A write frees
+// the frame once it is done, a read ahead maps the page into it.
 typedef struct {
-    INT16 disk_id;
-    INT32 sector_id;
-    INT32 buffer[PGSIZE];
-    int disk_operation;
-} DISK;
+    BOOL            busy;
+    int             operation;      // DISK_WRITE or DISK_READ
+    DISK_REQUEST    request;
+    INT32           frame;
+    INT32           pid;
+    INT32           page_id;
+    SHADOW_TABLE    slot;
+    char            buffer[PGSIZE]; // what is written out, or where a read ahead lands
+} PAGER_IO;
+
+struct TimerNode;
 
+// Scheduling statistics for a process, kept around after the PCB is gone
 typedef struct {
     INT32       pid;
-    INT32       delay;
+    char        name[MAX_NAME];
+    long        cpu_time;           // ticks spent running
+    INT32       switches;           // number of times the process was switched in
+    INT32       preemptions;        // number of times its time slice ran out
+    INT32       page_faults;
+} PROCESS_STATS;
+
+typedef struct Pcb {
+    INT32       pid;
+    INT32       delay;              // absolute time at which a sleeping process wakes up
     char        name[MAX_NAME];
     INT32       parent;
     INT32       state;
@@ -79,9 +168,27 @@ typedef struct {
     INT32       suspend_reason;
     void*       context;
     long        time_spent_processing;
+    INT32       last_dispatched;    // dispatch number of the last time this process ran, for round robin under -quantum=
+    INT32       sched_level;        // feedback queue level, 0 is the most interactive
+    long        vruntime;           // CPU time charged by the fair share scheduler
+    INT32       donor_pid;          // process that yielded its time slice to this one, -1 if none
+    INT32       resident_pages;     // frames the process holds right now
+    INT32       min_resident;       // frames it never has taken away by other processes
+    INT32       max_resident;       // frames it may hold at most, 0 for no limit
+    INT32       last_fault_page;    // page of its last fault, -1 before it has had one
+    INT32       fault_stride;       // distance between its last two faults
+    INT32       stream_length;      // faults in a row that distance apart
+    INT32       readahead_next;     // where a stream that was read ahead should fault next
+    INT32       readahead_window;   // pages to read ahead, grows with hits and shrinks with waste
+    INT32       prefetch_pending;   // pages read ahead and not yet seen used or evicted
+    INT32       prefetch_pages[MAX_PREFETCH_PENDING]; // which pages those are, in no particular order
     MESSAGE*    inbound_messages[MAX_MSG_COUNT];
     UINT16      pagetable[VIRTUAL_MEM_PGS];
-    DISK*       disk_data;
+    SHADOW_TABLE* shadow_table;     // where each paged out page is, NULL until one is
+    struct TimerNode* timer_node;   // where the process sits on the timer wheel, NULL when awake
+    struct WaitQueueData* wait_queue; // what the process is blocked on, NULL if nothing
+    struct Pcb* wait_next;          // the process after it on that queue
+    DISK_REQUEST* async_io[MAX_ASYNC_IO]; // its DISK_READ_ASYNC and DISK_WRITE_ASYNC, by handle
 } PCB;
 
 typedef void* func_ptr;
@@ -89,10 +196,19 @@ typedef void* func_ptr;
 //******** Function Prototypes *********//
 PCB* os_make_process(char* name, INT32 priority, INT32* error, void* entry_point, INT32 mode);
 void os_destroy_process(PCB* pcb);
+PCB* find_process(INT32 pid);
 void switch_context( PCB* pcb, short context_mode);
 void pcb_cascade_delete_by_parent(INT32 parent_pid);
 void dispatcher(void);
 void sleep_process(INT32 sleep_time, PCB* sleeping_process);
+void reset_timer(void);
+void give_up_cpu(void);
+void yield_to(PCB* target);
+void donate_slice(PCB* target);
+void preempt_if_needed(void);
+PROCESS_STATS* get_process_stats(INT32 pid);
+void parse_os_options(int argc, char* argv[]);
+void os_halt(void);
 func_ptr get_function_handle(char *name);
 void scheduler_printer(char* action);
 void memory_printer();
@@ -103,14 +219,57 @@ void clear_handled_broadcast_message();
 int find_handled_message(PCB* pcb);
 void lock_timer(void);
 void unlock_timer(void);
+void lock_disk(void);
+void unlock_disk(void);
 void lock_ready(void);
 void unlock_read(void);
 void lock_suspend(void);
 void unlock_suspend(void);
-UINT16 find_empty_frame(INT32 status);
-UINT16 page_replacement();
-int get_disk_status(long disk_id);
+INT32 find_empty_frame(INT32 status);
+INT32 page_replacement(INT32 page_id);
+INT32 take_frame(INT32 page_id);
+void copy_on_write(INT32 page_id);
+BOOL drop_shared_page(void);
+void clone_address_space(PCB* child);
+UINT16* frame_page_entry(INT32 frame);
+BOOL frame_evictable(INT32 frame, INT32 pid);
+long process_virtual_time(INT32 pid, INT32 current_time);
+void page_out(INT32 frame);
+void page_in(INT32 frame, INT32 page_id);
+void read_ahead(INT32 page_id);
+void swap_transfer(long disk_id, long sector_id, char* data, int operation);
+void release_swap(PCB* pcb);
+BOOL start_pageout_daemon(void);
+void wake_pageout_daemon(void);
+void frame_available(void);
+void pageout_daemon(void);
+INT32 user_process_count(void);
+void release_frames(PCB* pcb);
+BOOL disk_is_free(long disk_id);
+BOOL disk_is_ssd(long disk_id);
+BOOL disk_has_write_cache(long disk_id);
+BOOL block_device_exists(long disk_id);
+INT32 block_device_sectors(long disk_id);
+BOOL block_device_idle(long disk_id);
+INT32 add_volume(INT32 type, INT32 first_disk, INT32 member_count);
+void parse_volume(char* spec);
+void build_swap_volumes(void);
+void trim_sectors(long disk_id, long sector_id, INT32 count);
+void dispatch_disk(long disk_id);
+void finish_disk_request(DISK_REQUEST* request);
 void disk_read(long disk_id, long sector_id, char* read_buffer);
 void disk_write(long disk_id, long sector_id, char* write_buffer);
+void cached_disk_read(long disk_id, long sector_id, char* read_buffer);
+void cached_disk_write(long disk_id, long sector_id, char* write_buffer);
+INT32 flush_buffers(long disk_id, int operation);
+void flush_disk_caches(long disk_id);
+void wake_flush_daemon(void);
+void flush_daemon(void);
+INT32 start_async_io(long disk_id, long sector_id, char* buffer, int operation, BOOL notify, INT32* error);
+BOOL wait_async_io(INT32 handle);
+INT32 wait_any_async_io(void);
+void post_async_completions(PCB* pcb);
+void abandon_async_io(PCB* pcb);
+void disk_transfer_vector(struct DiskSegment* segments, INT32 count, int operation);
 
 #endif
\ No newline at end of file
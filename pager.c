@@ -0,0 +1,415 @@
+#include "pager.h"
+#include "string.h"
+
+/************************************************************************
+    Clock (second chance), preferring clean pages.
+    The hand sweeps round the frames.  A page that has been referenced
+    since the hand last passed gets its bit cleared and another chance.
+    The first unreferenced page that hasn't been modified is taken, since
+    it doesn't have to be written out.  If a whole lap turns up only dirty
+    ones we go round once more looking for a clean page that lost its
+    referenced bit on the way, and settle for the first dirty one after that.
+    A page that was read ahead gets a lap to be used in, same as if it
+    had been referenced.
+************************************************************************/
+static INT32 clock_hand = 0;
+
+static INT32 clock_choose_victim(FRAME* frames, INT32 frame_count, INT32 pid, INT32 current_time, long ws_window) {
+    INT32 dirty_victim = -1;
+    INT32 fallback = -1;
+    INT32 step;
+
+    for (step = 0; step < 2 * frame_count; step++) {
+        INT32 frame = clock_hand;
+        UINT16* entry = frame_page_entry(frame);
+
+        clock_hand = (clock_hand + 1) % frame_count;
+
+        if (!frame_evictable(frame, pid))
+            continue;
+
+        // nobody owns it any more, so it is free to take
+        if (entry == NULL)
+            return frame;
+
+        if (fallback == -1)
+            fallback = frame;
+
+        if (frames[frame].prefetched)
+            frames[frame].prefetched = FALSE;
+        else if (*entry & PTBL_REFERENCED_BIT)
+            *entry &= ~PTBL_REFERENCED_BIT;
+        else if (!(*entry & PTBL_MODIFIED_BIT))
+            return frame;
+        else if (dirty_victim == -1)
+            dirty_victim = frame;
+    }
+
+    if (dirty_victim != -1)
+        return dirty_victim;
+    return fallback;
+}
+
+/************************************************************************
+    FIFO.
+    Evicts whatever has been in memory longest, used or not.  It's only
+    here to measure the other policies against.
+************************************************************************/
+static INT32 fifo_hand = 0;
+
+static INT32 fifo_choose_victim(FRAME* frames, INT32 frame_count, INT32 pid, INT32 current_time, long ws_window) {
+    INT32 step;
+
+    for (step = 0; step < frame_count; step++) {
+        INT32 frame = fifo_hand;
+        fifo_hand = (fifo_hand + 1) % frame_count;
+
+        if (frame_evictable(frame, pid))
+            return frame;
+    }
+    return -1;
+}
+
+/************************************************************************
+    WSClock.
+    Like clock, but each page also remembers when it was last seen
+    referenced, in its owner's virtual time (how much CPU the owner has
+    had).  Seeing the referenced bit set moves that time up to now.  A
+    page that hasn't been used for longer than the window has dropped out
+    of its owner's working set, and only those are taken on the first
+    lap, clean ones first.  A process that is not running doesn't age, so
+    a process that is blocked keeps its working set.  If nothing has left
+    its working set the page that has gone unused the longest goes.
+************************************************************************/
+static INT32 wsclock_hand = 0;
+
+static INT32 wsclock_choose_victim(FRAME* frames, INT32 frame_count, INT32 pid, INT32 current_time, long ws_window) {
+    INT32 dirty_victim = -1;
+    INT32 oldest = -1;
+    long oldest_age = -1;
+    INT32 step;
+
+    for (step = 0; step < 2 * frame_count; step++) {
+        INT32 frame = wsclock_hand;
+        UINT16* entry = frame_page_entry(frame);
+        long now;
+        long age;
+
+        wsclock_hand = (wsclock_hand + 1) % frame_count;
+
+        if (!frame_evictable(frame, pid))
+            continue;
+
+        // nobody owns it any more, so it is free to take
+        if (entry == NULL)
+            return frame;
+
+        now = process_virtual_time(frames[frame].pid, current_time);
+        if (*entry & PTBL_REFERENCED_BIT) {
+            *entry &= ~PTBL_REFERENCED_BIT;
+            frames[frame].last_used = now;
+            continue;
+        }
+
+        age = now - frames[frame].last_used;
+        if (age > ws_window) {
+            if (!(*entry & PTBL_MODIFIED_BIT))
+                return frame;
+            if (dirty_victim == -1)
+                dirty_victim = frame;
+        }
+
+        if (age > oldest_age) {
+            oldest = frame;
+            oldest_age = age;
+        }
+    }
+
+    if (dirty_victim != -1)
+        return dirty_victim;
+    return oldest;
+}
+
+/************************************************************************
+    CAR (clock with adaptive replacement).
+    ARC needs to see every access, and all we get is the referenced bit,
+    so this is the clock version of it.  Frames are on one of two clocks:
+    T1 holds pages used once lately and T2 pages used again after that.
+    Pages evicted from each clock are remembered, by pid and page number,
+    on the ghost lists B1 and B2.  A fault on a page in B1 means T1 is too
+    small and a fault on one in B2 means T2 is, and car_target (how big
+    T1 should be) moves accordingly.  A scan only ever fills T1, so it
+    can't push the hot pages out of T2.
+
+    The fault handler marks a page referenced when it loads it, and the
+    faulting access would set the bit anyway, so a T1 page has to be
+    found referenced on two passes of the hand before it moves to T2.
+************************************************************************/
+typedef struct {
+    INT32   next;
+    INT32   prev;
+    INT32   list;           // CAR_T1 ... CAR_FREE, or CAR_NONE
+    INT32   pid;            // page a ghost stands for
+    INT32   page_id;
+    INT32   hash_next;      // next ghost in the same hash bucket
+    BOOL    seen;           // T1 page already found referenced once
+} CAR_NODE;
+
+typedef struct {
+    INT32   head;
+    INT32   tail;
+    INT32   length;
+} CAR_LIST;
+
+// nodes 0 .. c - 1 are the frames themselves, the 2c after that are ghosts
+static CAR_NODE* car_nodes = NULL;
+static CAR_LIST  car_lists[CAR_LISTS];
+static INT32*    car_buckets = NULL;
+static INT32     car_size = 0;
+static INT32     car_target = 0;
+
+static void car_unlink(INT32 node) {
+    CAR_LIST* l;
+
+    if (car_nodes[node].list == CAR_NONE)
+        return;
+    l = &car_lists[car_nodes[node].list];
+
+    if (car_nodes[node].prev == -1)
+        l->head = car_nodes[node].next;
+    else
+        car_nodes[car_nodes[node].prev].next = car_nodes[node].next;
+
+    if (car_nodes[node].next == -1)
+        l->tail = car_nodes[node].prev;
+    else
+        car_nodes[car_nodes[node].next].prev = car_nodes[node].prev;
+
+    l->length--;
+    car_nodes[node].list = CAR_NONE;
+}
+
+static void car_append(INT32 list, INT32 node) {
+    CAR_LIST* l = &car_lists[list];
+
+    car_unlink(node);
+    car_nodes[node].list = list;
+    car_nodes[node].next = -1;
+    car_nodes[node].prev = l->tail;
+
+    if (l->tail == -1)
+        l->head = node;
+    else
+        car_nodes[l->tail].next = node;
+    l->tail = node;
+    l->length++;
+}
+
+static INT32 car_bucket(INT32 pid, INT32 page_id) {
+    return (INT32) (((UINT32) pid * VIRTUAL_MEM_PGS + (UINT32) page_id) % (UINT32) (2 * car_size));
+}
+
+static void car_setup(INT32 frame_count) {
+    INT32 i;
+
+    if (car_nodes != NULL)
+        return;
+
+    car_size = frame_count;
+    car_nodes = (CAR_NODE*) calloc(3 * car_size, sizeof(CAR_NODE));
+    car_buckets = (INT32*) calloc(2 * car_size, sizeof(INT32));
+
+    for (i = 0; i < CAR_LISTS; i++) {
+        car_lists[i].head = -1;
+        car_lists[i].tail = -1;
+        car_lists[i].length = 0;
+    }
+    for (i = 0; i < 2 * car_size; i++)
+        car_buckets[i] = -1;
+    for (i = 0; i < 3 * car_size; i++)
+        car_nodes[i].list = CAR_NONE;
+    for (i = car_size; i < 3 * car_size; i++)
+        car_append(CAR_FREE, i);
+}
+
+/**
+* Finds the ghost for a page, or -1 if it wasn't evicted lately
+*/
+static INT32 car_find_ghost(INT32 pid, INT32 page_id) {
+    INT32 ghost = car_buckets[car_bucket(pid, page_id)];
+
+    while (ghost != -1 && (car_nodes[ghost].pid != pid || car_nodes[ghost].page_id != page_id))
+        ghost = car_nodes[ghost].hash_next;
+    return ghost;
+}
+
+static void car_forget_ghost(INT32 ghost) {
+    INT32* link = &car_buckets[car_bucket(car_nodes[ghost].pid, car_nodes[ghost].page_id)];
+
+    while (*link != ghost)
+        link = &car_nodes[*link].hash_next;
+    *link = car_nodes[ghost].hash_next;
+
+    car_append(CAR_FREE, ghost);
+}
+
+static void car_remember(INT32 list, INT32 pid, INT32 page_id) {
+    INT32 ghost;
+    INT32 bucket;
+
+    // there are only 2c ghosts; if they're all in use the oldest goes
+    if (car_lists[CAR_FREE].length == 0)
+        car_forget_ghost(car_lists[CAR_B1].length > car_lists[CAR_B2].length ?
+                         car_lists[CAR_B1].head : car_lists[CAR_B2].head);
+
+    ghost = car_lists[CAR_FREE].head;
+    bucket = car_bucket(pid, page_id);
+    car_nodes[ghost].pid = pid;
+    car_nodes[ghost].page_id = page_id;
+    car_nodes[ghost].hash_next = car_buckets[bucket];
+    car_buckets[bucket] = ghost;
+    car_append(list, ghost);
+}
+
+/**
+* The frame goes, and its page is remembered on the ghost list that
+* goes with the clock it was on
+*/
+static INT32 car_evict(FRAME* frames, INT32 frame) {
+    INT32 list = car_nodes[frame].list;
+
+    car_unlink(frame);
+    if (frame_page_entry(frame) != NULL)
+        car_remember(list == CAR_T2 ? CAR_B2 : CAR_B1, frames[frame].pid, frames[frame].page_id);
+    return frame;
+}
+
+static INT32 car_choose_victim(FRAME* frames, INT32 frame_count, INT32 pid, INT32 current_time, long ws_window) {
+    INT32 step;
+    INT32 frame;
+
+    car_setup(frame_count);
+
+    for (step = 0; step < 4 * frame_count; step++) {
+        INT32 list;
+        UINT16* entry;
+
+        if (car_lists[CAR_T1].length == 0 && car_lists[CAR_T2].length == 0)
+            break;
+
+        // T1 gives up a page while it is over its target size
+        if (car_lists[CAR_T2].length == 0 ||
+                (car_lists[CAR_T1].length > 0 && car_lists[CAR_T1].length >= (car_target > 1 ? car_target : 1)))
+            list = CAR_T1;
+        else
+            list = CAR_T2;
+
+        frame = car_lists[list].head;
+        entry = frame_page_entry(frame);
+
+        // not ours to take, so it goes round again as it is
+        if (!frame_evictable(frame, pid)) {
+            car_append(list, frame);
+            continue;
+        }
+
+        if (entry == NULL)
+            return car_evict(frames, frame);
+
+        // a page that was read ahead gets a lap to be used in
+        if (frames[frame].prefetched) {
+            frames[frame].prefetched = FALSE;
+            car_append(list, frame);
+            continue;
+        }
+
+        if (*entry & PTBL_REFERENCED_BIT) {
+            *entry &= ~PTBL_REFERENCED_BIT;
+            if (list == CAR_T1 && !car_nodes[frame].seen) {
+                car_nodes[frame].seen = TRUE;
+                car_append(CAR_T1, frame);
+            }
+            else
+                car_append(CAR_T2, frame);
+            continue;
+        }
+
+        return car_evict(frames, frame);
+    }
+
+    // everything the hands came to was off limits, so take anything we may
+    for (frame = 0; frame < frame_count; frame++) {
+        if (frame_evictable(frame, pid))
+            return car_evict(frames, frame);
+    }
+    return -1;
+}
+
+static void car_page_loaded(FRAME* frames, INT32 frame_count, INT32 frame) {
+    INT32 ghost;
+    INT32 ratio;
+
+    car_setup(frame_count);
+    ghost = car_find_ghost(frames[frame].pid, frames[frame].page_id);
+    car_nodes[frame].seen = FALSE;
+
+    if (ghost == -1) {
+        // a page we haven't seen lately; keep the history no bigger than 2c
+        if (car_lists[CAR_T1].length + car_lists[CAR_B1].length >= car_size && car_lists[CAR_B1].length > 0)
+            car_forget_ghost(car_lists[CAR_B1].head);
+        else if (car_lists[CAR_T1].length + car_lists[CAR_T2].length + car_lists[CAR_B1].length +
+                 car_lists[CAR_B2].length >= 2 * car_size && car_lists[CAR_B2].length > 0)
+            car_forget_ghost(car_lists[CAR_B2].head);
+        car_append(CAR_T1, frame);
+    }
+    else if (car_nodes[ghost].list == CAR_B1) {
+        // T1 should have kept it, so let T1 grow
+        ratio = car_lists[CAR_B2].length / car_lists[CAR_B1].length;
+        car_target += ratio > 1 ? ratio : 1;
+        if (car_target > car_size)
+            car_target = car_size;
+        car_forget_ghost(ghost);
+        car_append(CAR_T2, frame);
+    }
+    else {
+        // T2 should have kept it, so let T2 grow
+        ratio = car_lists[CAR_B1].length / car_lists[CAR_B2].length;
+        car_target -= ratio > 1 ? ratio : 1;
+        if (car_target < 0)
+            car_target = 0;
+        car_forget_ghost(ghost);
+        car_append(CAR_T2, frame);
+    }
+}
+
+/**
+* A free frame holds nobody's page, so it comes off whichever clock it is
+* on.  Otherwise the hands would keep visiting it, and it would still
+* count towards T1 or T2 when the target size is worked out.
+*/
+static void car_frame_freed(FRAME* frames, INT32 frame_count, INT32 frame) {
+    car_setup(frame_count);
+    car_unlink(frame);
+    car_nodes[frame].seen = FALSE;
+}
+
+static PAGER_POLICY policies[] = {
+    { "clock",   clock_choose_victim,   NULL,            NULL },
+    { "fifo",    fifo_choose_victim,    NULL,            NULL },
+    { "wsclock", wsclock_choose_victim, NULL,            NULL },
+    { "car",     car_choose_victim,     car_page_loaded, car_frame_freed },
+};
+
+/**
+* Look up a replacement policy by the name given on the command line.
+* Returns NULL if there is no policy by that name.
+*/
+PAGER_POLICY* find_pager_policy(char* name) {
+    int i;
+
+    for (i = 0; i < (int) (sizeof(policies) / sizeof(policies[0])); i++) {
+        if (strcmp(policies[i].name, name) == 0)
+            return &policies[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef PAGER
+#define PAGER
+#include "my_globals.h"
+
+// CAR keeps every frame on one of two clocks, and remembers pages it
+// evicted lately on one of two ghost lists
+#define         CAR_T1                      0       // frames used once lately
+#define         CAR_T2                      1       // frames used more than once
+#define         CAR_B1                      2       // pages evicted from T1
+#define         CAR_B2                      3       // pages evicted from T2
+#define         CAR_FREE                    4       // ghost entries nobody is using
+#define         CAR_LISTS                   5
+#define         CAR_NONE                    -1
+
+// A replacement policy decides which frame to take away when memory is full
+typedef struct {
+    char*   name;
+
+    // pick the frame to evict, or -1 if there is nothing that may go.
+    // pid limits the choice to that process's own frames, -1 means anyone's.
+    // ws_window is how long a page stays in its owner's working set.
+    INT32   (*choose_victim)(FRAME* frames, INT32 frame_count, INT32 pid, INT32 current_time, long ws_window);
+
+    // a page has just been put in this frame for its new owner; NULL if the policy doesn't care
+    void    (*page_loaded)(FRAME* frames, INT32 frame_count, INT32 frame);
+
+    // the frame has gone back on the free list; NULL if the policy doesn't care
+    void    (*frame_freed)(FRAME* frames, INT32 frame_count, INT32 frame);
+} PAGER_POLICY;
+
+// function prototypes
+PAGER_POLICY* find_pager_policy(char* name);
+
+#endif
@@ -65,6 +65,22 @@ void   test2f( void );
 void   test2g( void );
 void   test2h( void );
 void   test2cAlt( void );
+void   test3a( void );
+void   test3b( void );
+void   test3c( void );
+void   test3d( void );
+void   test3e( void );
+void   test3f( void );
+void   test3g( void );
+void   test3h( void );
+void   test3i( void );
+void   test3j( void );
+void   test3k( void );
+void   test3l( void );
+void   test3m( void );
+void   test3n( void );
+void   test3o( void );
+void   test3p( void );
 
 
 //                      ENTRIES in z502.c
@@ -81,6 +97,7 @@ void   Z502MemoryWrite(INT32, INT32 * );
 void   Z502ReadPhysicalMemory( INT32, char *);
 void   Z502WritePhysicalMemory( INT32, char *);
 void   Z502MakeContext( void **, void *, BOOL );
+void   Z502SetPageTable( void **, UINT16 *, INT16 );
 void   Z502SwitchContext( BOOL, void ** );
 void   *Z502PrepareProcessForExecution( void );
 void   Z502MemoryReadModify( INT32, INT32, INT32, INT32 * );
@@ -0,0 +1,171 @@
+#include "scheduler.h"
+#include "string.h"
+
+/**
+* Same test build_ready_queue uses for whether a process can be run
+*/
+static BOOL is_runnable(PCB* p) {
+    return (p->state == CREATE) || (p->state == READY) || (p->state == RUNNING);
+}
+
+/**
+* Round robin tie break: whoever ran longest ago goes first
+*/
+static BOOL ran_before(PCB* a, PCB* b) {
+    return a->last_dispatched < b->last_dispatched;
+}
+
+/************************************************************************
+    Strict priority, round robin within a priority level.
+    This is what the OS has always done.
+************************************************************************/
+static PCB* priority_pick_next(LinkedList process_list, INT32 current_time) {
+    PCB* process_to_run = NULL;
+    LinkedList ready_queue = build_ready_queue(process_list);
+
+    if (ready_queue->data != NULL)
+        process_to_run = ready_queue->data;
+
+    free_ready_queue(ready_queue);
+    return process_to_run;
+}
+
+static void priority_descheduled(PCB* p, INT32 ran_for, BOOL used_full_slice) {
+}
+
+static INT32 priority_quantum(PCB* p, INT32 base_quantum) {
+    return base_quantum;
+}
+
+/************************************************************************
+    Multilevel feedback queue.
+    A process that burns through its whole slice is CPU bound and drops a
+    level; one that gives up the CPU early is waiting on I/O and moves up.
+    Every so often everyone goes back to the top so nothing starves.
+************************************************************************/
+static INT32 last_boost = 0;
+
+static PCB* mlfq_pick_next(LinkedList process_list, INT32 current_time) {
+    PCB* best = NULL;
+    Node* cursor;
+
+    if (current_time - last_boost >= MLFQ_BOOST_INTERVAL) {
+        for (cursor = process_list; cursor != NULL; cursor = cursor->next) {
+            if (cursor->data != NULL)
+                cursor->data->sched_level = 0;
+        }
+        last_boost = current_time;
+    }
+
+    for (cursor = process_list; cursor != NULL; cursor = cursor->next) {
+        PCB* p = cursor->data;
+        if (p == NULL || !is_runnable(p))
+            continue;
+
+        if (best == NULL || p->sched_level < best->sched_level)
+            best = p;
+        else if (p->sched_level == best->sched_level) {
+            if (p->priority < best->priority)
+                best = p;
+            else if (p->priority == best->priority && ran_before(p, best))
+                best = p;
+        }
+    }
+
+    return best;
+}
+
+static void mlfq_descheduled(PCB* p, INT32 ran_for, BOOL used_full_slice) {
+    if (used_full_slice) {
+        if (p->sched_level < MLFQ_LEVELS - 1)
+            p->sched_level++;
+    }
+    else if (p->sched_level > 0)
+        p->sched_level--;
+}
+
+static INT32 mlfq_quantum(PCB* p, INT32 base_quantum) {
+    return base_quantum << p->sched_level;
+}
+
+/************************************************************************
+    Fair share.
+    Each process is charged virtual runtime for the CPU it uses, scaled
+    down for better priorities, and the one with the least goes next.
+    A process that slept a long time comes back no further behind than
+    the least charged runnable one, or it would have the CPU to itself
+    until it caught up.
+************************************************************************/
+static long fair_floor = 0;     // virtual runtime of the last process picked, never goes down
+
+static PCB* fair_pick_next(LinkedList process_list, INT32 current_time) {
+    PCB* best = NULL;
+    Node* cursor;
+
+    for (cursor = process_list; cursor != NULL; cursor = cursor->next) {
+        PCB* p = cursor->data;
+        if (p == NULL || !is_runnable(p))
+            continue;
+
+        if (p->vruntime < fair_floor)
+            p->vruntime = fair_floor;
+        if (best == NULL || p->vruntime < best->vruntime)
+            best = p;
+        else if (p->vruntime == best->vruntime && ran_before(p, best))
+            best = p;
+    }
+
+    if (best != NULL)
+        fair_floor = best->vruntime;
+    return best;
+}
+
+static void fair_descheduled(PCB* p, INT32 ran_for, BOOL used_full_slice) {
+    p->vruntime += ((long) ran_for * FAIR_WEIGHT(DEFAULT_PRIORITY)) / FAIR_WEIGHT(p->priority);
+}
+
+static INT32 fair_quantum(PCB* p, INT32 base_quantum) {
+    return base_quantum;
+}
+
+static SCHEDULER_POLICY policies[] = {
+    { "priority", priority_pick_next, priority_descheduled, priority_quantum },
+    { "mlfq",     mlfq_pick_next,     mlfq_descheduled,     mlfq_quantum },
+    { "fair",     fair_pick_next,     fair_descheduled,     fair_quantum },
+};
+
+/**
+* Look up a policy by the name given on the command line.
+* Returns NULL if there is no policy by that name.
+*/
+SCHEDULER_POLICY* find_scheduler_policy(char* name) {
+    int i;
+
+    for (i = 0; i < (int) (sizeof(policies) / sizeof(policies[0])); i++) {
+        if (strcmp(policies[i].name, name) == 0)
+            return &policies[i];
+    }
+    return NULL;
+}
+
+/**
+* Sets up the scheduling state of a brand new process.  It starts on the top
+* level of the feedback queue, and with as much virtual runtime as the least
+* charged process so it can't monopolize the CPU while it catches up.
+*/
+void scheduler_admit(LinkedList process_list, PCB* p) {
+    Node* cursor;
+    BOOL found = FALSE;
+
+    p->sched_level = 0;
+    p->vruntime = 0;
+
+    for (cursor = process_list; cursor != NULL; cursor = cursor->next) {
+        if (cursor->data == NULL || cursor->data == p)
+            continue;
+
+        if (!found || cursor->data->vruntime < p->vruntime)
+            p->vruntime = cursor->data->vruntime;
+        found = TRUE;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef SCHEDULER
+#define SCHEDULER
+#include "my_globals.h"
+#include "list.h"
+
+// Multilevel feedback queue: level 0 is the most interactive,
+// and each level down gets a slice twice as long as the one above it
+#define         MLFQ_LEVELS                 4
+#define         MLFQ_BOOST_INTERVAL         5000    // ticks between moving everyone back up to level 0
+#define         MLFQ_DEFAULT_QUANTUM        100     // slice at level 0 when -sched=mlfq comes without -quantum=
+
+// Fair share: how much a tick of CPU counts for depends on priority.
+// A process at DEFAULT_PRIORITY is charged one tick of virtual runtime per tick.
+#define         FAIR_WEIGHT(priority)       (MAX_PRIORITY - (priority) + 1)
+
+// A scheduling policy is just the three decisions the dispatcher needs made
+typedef struct {
+    char*   name;
+
+    // pick the next process to run from the process list, or NULL if nobody is ready
+    PCB*    (*pick_next)(LinkedList process_list, INT32 current_time);
+
+    // a process is coming off the CPU after running for ran_for ticks;
+    // used_full_slice is TRUE when it was preempted rather than giving up the CPU
+    void    (*descheduled)(PCB* p, INT32 ran_for, BOOL used_full_slice);
+
+    // how long a time slice this process gets
+    INT32   (*quantum)(PCB* p, INT32 base_quantum);
+} SCHEDULER_POLICY;
+
+// function prototypes
+SCHEDULER_POLICY* find_scheduler_policy(char* name);
+void scheduler_admit(LinkedList process_list, PCB* p);
+
+#endif
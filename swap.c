@@ -0,0 +1,118 @@
+#include "swap.h"
+
+/**
+* Returns a swap area made of disk_count disks or volumes from first_disk
+* on, each disk_sectors long, all of it free.  device_idle says whether a
+* disk could start a transfer right now.
+*/
+SwapArea create_swap_area(INT32 first_disk, INT32 disk_count, INT32 disk_sectors, BOOL (*device_idle)(long disk_id)) {
+    SwapArea s = (SwapArea) calloc(1, sizeof(SwapAreaData));
+    INT32 disk;
+
+    // In case we are out of memory, or something crazy happens...
+    if (s == NULL) {
+        printf("Could not create swap area...");
+        return NULL;
+    }
+
+    s->disk_count = disk_count;
+    s->first_disk = first_disk;
+    s->disk_sectors = disk_sectors;
+    s->next_disk = 0;
+    s->device_idle = device_idle;
+
+    // sectors are handed out just like frames are
+    for (disk = 0; disk < disk_count; disk++)
+        s->sectors[disk] = create_frame_bitmap(disk_sectors);
+    return s;
+}
+
+/**
+* Gives a page a disk and sector of its own to be written out to.  The
+* disks take turns, so pages written out one after the other end up on
+* different disks, but one that is idle right now goes ahead of one that
+* is busy.  Returns FALSE if the swap area is full.
+*/
+BOOL swap_alloc(SwapArea s, SHADOW_TABLE* entry) {
+    INT32 chosen = -1;
+    INT32 disk;
+    INT32 i;
+
+    if (s == NULL)
+        return FALSE;
+
+    for (i = 0; i < s->disk_count; i++) {
+        disk = (s->next_disk + i) % s->disk_count;
+        if (frame_bitmap_free_count(s->sectors[disk]) == 0)
+            continue;
+
+        if (chosen == -1)
+            chosen = disk;
+        if (s->device_idle(s->first_disk + disk)) {
+            chosen = disk;
+            break;
+        }
+    }
+
+    if (chosen == -1)
+        return FALSE;
+
+    entry->disk_id = s->first_disk + chosen;
+    entry->sector_id = frame_bitmap_alloc(s->sectors[chosen]);
+    entry->in_use = TRUE;
+    s->next_disk = (chosen + 1) % s->disk_count;
+    return TRUE;
+}
+
+/**
+* Hands a page's disk and sector back.  The page no longer has a copy on disk.
+*/
+void swap_free(SwapArea s, SHADOW_TABLE* entry) {
+    if (s == NULL || !entry->in_use)
+        return;
+
+    frame_bitmap_free(s->sectors[entry->disk_id - s->first_disk], entry->sector_id);
+    entry->in_use = FALSE;
+    entry->disk_id = -1;
+    entry->sector_id = -1;
+}
+
+/**
+* TRUE if nobody is using any sector of the SWAP_TRIM_CLUSTER that
+* sector_id is in
+*/
+BOOL swap_cluster_is_free(SwapArea s, INT32 disk_id, INT32 sector_id) {
+    INT32 first = sector_id - sector_id % SWAP_TRIM_CLUSTER;
+    INT32 sector;
+
+    if (s == NULL || disk_id < s->first_disk || disk_id >= s->first_disk + s->disk_count)
+        return FALSE;
+    for (sector = first; sector < first + SWAP_TRIM_CLUSTER; sector++) {
+        if (!frame_bitmap_is_free(s->sectors[disk_id - s->first_disk], sector))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+* Return the number of sectors nobody is using
+*/
+INT32 swap_free_count(SwapArea s) {
+    INT32 free = 0;
+    INT32 disk;
+
+    if (s == NULL)
+        return 0;
+    for (disk = 0; disk < s->disk_count; disk++)
+        free += frame_bitmap_free_count(s->sectors[disk]);
+    return free;
+}
+
+/**
+* Return the number of sectors in the swap area
+*/
+INT32 swap_slot_count(SwapArea s) {
+    if (s == NULL)
+        return 0;
+    return s->disk_count * s->disk_sectors;
+}
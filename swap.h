@@ -0,0 +1,34 @@
+#ifndef SWAP
+#define SWAP
+#include "my_globals.h"
+#include "frame_bitmap.h"
+
+// The swap area is every sector of a run of disks at the top of the
+// disk numbers.  Processes can't get at those disks, so the pages on
+// them are safe from the tests' own disk I/O.  Pages are striped across
+// them so their transfers can overlap.
+typedef struct {
+    INT32       first_disk;
+    INT32       disk_count;
+    INT32       disk_sectors;   // sectors on each of them
+    FrameBitmap sectors[MAX_NUMBER_OF_DISKS];   // a bit per sector of each disk, set while it is free
+    INT32       next_disk;      // where the round robin hands out the next sector
+
+    // TRUE if a transfer to that disk would start straight away; the
+    // kernel knows what the disks are doing, the swap area doesn't
+    BOOL        (*device_idle)(long disk_id);
+} SwapAreaData, *SwapArea;
+
+// A solid state disk is told to forget swap sectors this many at a time,
+// once every one of them is free
+#define         SWAP_TRIM_CLUSTER       FRAME_BITMAP_WORD_BITS
+
+// function prototypes
+SwapArea create_swap_area(INT32 first_disk, INT32 disk_count, INT32 disk_sectors, BOOL (*device_idle)(long disk_id));
+BOOL swap_alloc(SwapArea s, SHADOW_TABLE* entry);
+void swap_free(SwapArea s, SHADOW_TABLE* entry);
+BOOL swap_cluster_is_free(SwapArea s, INT32 disk_id, INT32 sector_id);
+INT32 swap_free_count(SwapArea s);
+INT32 swap_slot_count(SwapArea s);
+
+#endif
@@ -43,6 +43,18 @@
 #define         SYSNUM_DISK_READ                       13
 #define         SYSNUM_DISK_WRITE                      14
 #define         SYSNUM_DEFINE_SHARED_AREA              15
+#define         SYSNUM_GET_PAGE_FAULTS                 16
+#define         SYSNUM_GET_RESIDENT_SET                17
+#define         SYSNUM_SET_RESIDENT_LIMITS             18
+#define         SYSNUM_CREATE_PROCESS_COPY             19
+#define         SYSNUM_FLUSH_DISK                      20
+#define         SYSNUM_DISK_READ_ASYNC                 21
+#define         SYSNUM_DISK_WRITE_ASYNC                22
+#define         SYSNUM_DISK_WAIT                       23
+#define         SYSNUM_DISK_WAIT_ANY                   24
+#define         SYSNUM_DISK_POLL                       25
+#define         SYSNUM_DISK_READV                      26
+#define         SYSNUM_DISK_WRITEV                     27
 
 // This structure defines the format used for all system calls.
 // For each call, the structure is filled in and then its address
@@ -55,6 +67,14 @@ typedef struct    {
     long *Argument[MAX_NUMBER_ARGUMENTS];
 } SYSTEM_CALL_DATA;
 
+// DISK_READV and DISK_WRITEV take an array of these, one per sector.
+#define         MAX_DISK_SEGMENTS                      64
+typedef struct  DiskSegment  {
+    long  disk_id;
+    long  sector_id;
+    char  *buffer;
+} DISK_SEGMENT;
+
 
 extern void ChargeTimeAndCheckEvents(INT32);
 extern int BaseThread();
@@ -300,6 +320,193 @@ extern int BaseThread();
                 }                                                              \
 
 
+#define         GET_PAGE_FAULTS( arg1, arg2, arg3)   {                         \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 4;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_GET_PAGE_FAULTS;     \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         GET_RESIDENT_SET( arg1, arg2, arg3)   {                        \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 4;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_GET_RESIDENT_SET;    \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         SET_RESIDENT_LIMITS( arg1, arg2, arg3, arg4 )   {              \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 5;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_SET_RESIDENT_LIMITS; \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                SystemCallData->Argument[3] = (long *)arg4;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         CREATE_PROCESS_COPY( arg1, arg2, arg3, arg4, arg5 )   {        \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 6;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_CREATE_PROCESS_COPY; \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                SystemCallData->Argument[3] = (long *)arg4;                    \
+                SystemCallData->Argument[4] = (long *)arg5;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         FLUSH_DISK( arg1, arg2 )   {                                   \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 3;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_FLUSH_DISK;          \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_READ_ASYNC( arg1, arg2, arg3, arg4, arg5, arg6 )   {      \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 7;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_READ_ASYNC;     \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                SystemCallData->Argument[3] = (long *)arg4;                    \
+                SystemCallData->Argument[4] = (long *)arg5;                    \
+                SystemCallData->Argument[5] = (long *)arg6;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_WRITE_ASYNC( arg1, arg2, arg3, arg4, arg5, arg6 )   {     \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 7;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_WRITE_ASYNC;    \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                SystemCallData->Argument[3] = (long *)arg4;                    \
+                SystemCallData->Argument[4] = (long *)arg5;                    \
+                SystemCallData->Argument[5] = (long *)arg6;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_WAIT( arg1, arg2 )   {                                    \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 3;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_WAIT;           \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_WAIT_ANY( arg1, arg2 )   {                                \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 3;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_WAIT_ANY;       \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_POLL( arg1, arg2, arg3 )   {                              \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 4;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_POLL;           \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_READV( arg1, arg2, arg3 )   {                             \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 4;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_READV;          \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+#define         DISK_WRITEV( arg1, arg2, arg3 )   {                            \
+                SYSTEM_CALL_DATA *SystemCallData =                             \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 4;                         \
+                SystemCallData->SystemCallNumber = SYSNUM_DISK_WRITEV;         \
+                SystemCallData->Argument[0] = (long *)arg1;                    \
+                SystemCallData->Argument[1] = (long *)arg2;                    \
+                SystemCallData->Argument[2] = (long *)arg3;                    \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );             \
+                Z502_MODE = KERNEL_MODE;                                       \
+                svc(SystemCallData);                                           \
+                Z502_MODE = USER_MODE;                                         \
+                free(SystemCallData);                                          \
+                }                                                              \
+
+
 /*      This section includes items needed in the scheduler printer.
  It's also useful for those routines that want to communicate
  with the scheduler printer.                                       */
@@ -41,6 +41,7 @@
 #include         "global.h"
 #include         "protos.h"
 #include         "syscalls.h"
+#include         "z502.h"
 
 #include         "stdio.h"
 #include         "string.h"
@@ -65,6 +66,16 @@ extern INT16 Z502_MODE;
 void   test1x(void);
 void   test1j_echo(void);
 void   test2hx(void);
+void   test3x(void);
+void   test3y(void);
+void   test3z(void);
+void   test3w(void);
+void   test3v(void);
+void   test3u(void);
+void   test3t(void);
+void   test3s(void);
+void   test3r(void);
+void   test3q(void);
 void   ErrorExpected(INT32, char[]);
 void   SuccessExpected(INT32, char[]);
 void   get_skewed_random_number( long *, long );
@@ -2003,6 +2014,1727 @@ void test2hx(void) {
 
 }                                // End of test2hx   
 
+/**************************************************************************
+
+ Test3a
+
+ Starts several CPU bound processes at the same priority.  None of them
+ ever sleeps, so the only way they can share the CPU is if the OS
+ preempts them when their time slice runs out, so run it with a quantum
+ (e.g. -quantum=100).  The halt statistics should show each of them with
+ roughly the same share of the CPU.
+
+ Z502_REG1 - Z502_REG3  PIDs of the spinning processes
+ Z502_REG9              Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3A                 10
+#define         NUMBER_OF_TEST3X_PROCESSES  3
+#define         TEST3X_RUN_TIME             2000
+
+void test3a(void) {
+    static long   sleep_time = 500;
+
+    printf("This is Release %s:  Test 3a\n", CURRENT_REL);
+    CREATE_PROCESS("test3a_1", test3x, PRIORITY_3A, &Z502_REG1, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3a_2", test3x, PRIORITY_3A, &Z502_REG2, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3a_3", test3x, PRIORITY_3A, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    // Wait until the last of the spinners is gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        GET_PROCESS_ID("test3a_3", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3a_2", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3a_1", &Z502_REG6, &Z502_REG9);
+    }
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3a
+
+/**************************************************************************
+
+ Test3b
+
+ A mixed workload for comparing scheduling policies.  Two CPU bound
+ processes (test3x) compete with two I/O bound ones (test3y) that do a
+ little work and then sleep.  Run it with a quantum (e.g. -quantum=100)
+ and each -sched= policy:
+ test3x reports how much work it got done (throughput), and test3y
+ reports how long it waited to get the CPU back after each sleep
+ (response time).
+
+ Z502_REG1 - Z502_REG4  PIDs of the workload processes
+ Z502_REG9              Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3B                 10
+#define         NUMBER_OF_TEST3Y_ITERATIONS 20
+#define         TEST3Y_BURST                5
+#define         TEST3Y_SLEEP                50
+
+void test3b(void) {
+    static long   sleep_time = 500;
+
+    printf("This is Release %s:  Test 3b\n", CURRENT_REL);
+    CREATE_PROCESS("test3b_cpu1", test3x, PRIORITY_3B, &Z502_REG1, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3b_io1", test3y, PRIORITY_3B, &Z502_REG2, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3b_cpu2", test3x, PRIORITY_3B, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3b_io2", test3y, PRIORITY_3B, &Z502_REG4, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    // Wait until everyone in the workload is gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        GET_PROCESS_ID("test3b_cpu1", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3b_cpu2", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3b_io1", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3b_io2", &Z502_REG6, &Z502_REG9);
+    }
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3b
+
+/**************************************************************************
+
+ Test3c
+
+ Message ping-pong latency.  We bounce a message off an echo process
+ (test1j_echo) over and over and time each round trip, while a CPU bound
+ process at the same priority competes for the CPU.  Run it with a
+ quantum (e.g. -quantum=100) and compare the round trip times with and
+ without -directed_yield=1.
+
+ Z502_REG1              PID of the echo process
+ Z502_REG2              PID of the CPU bound process
+ Z502_REG9              Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3C                 10
+#define         NUMBER_OF_TEST3C_ROUND_TRIPS  20
+
+void test3c(void) {
+    char   msg_buffer[LEGAL_MESSAGE_LENGTH];
+    long   sender_pid;
+    long   message_length;
+    long   round_trip;
+    long   total_round_trip = 0;
+    long   worst_round_trip = 0;
+    int    trip;
+
+    printf("This is Release %s:  Test 3c\n", CURRENT_REL);
+
+    // we compete at the same priority as everyone else
+    CHANGE_PRIORITY(-1, PRIORITY_3C, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CHANGE_PRIORITY");
+
+    CREATE_PROCESS("test3c_echo", test1j_echo, PRIORITY_3C, &Z502_REG1, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3c_cpu", test3x, PRIORITY_3C, &Z502_REG2, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    // give the echo process a chance to start waiting for messages
+    SLEEP(100);
+
+    for (trip = 0; trip < NUMBER_OF_TEST3C_ROUND_TRIPS; trip++) {
+        sprintf(msg_buffer, "ping %d", trip);
+
+        GET_TIME_OF_DAY(&Z502_REG3);
+        SEND_MESSAGE(Z502_REG1, msg_buffer, (long) strlen(msg_buffer) + 1, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "SEND_MESSAGE");
+
+        RECEIVE_MESSAGE(Z502_REG1, msg_buffer, LEGAL_MESSAGE_LENGTH,
+                &message_length, &sender_pid, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "RECEIVE_MESSAGE");
+        GET_TIME_OF_DAY(&Z502_REG4);
+
+        round_trip = Z502_REG4 - Z502_REG3;
+        total_round_trip += round_trip;
+        if (round_trip > worst_round_trip)
+            worst_round_trip = round_trip;
+    }
+
+    printf("Test3c: %d round trips, Average Round Trip = %ld, Worst Round Trip = %ld\n",
+            NUMBER_OF_TEST3C_ROUND_TRIPS,
+            total_round_trip / NUMBER_OF_TEST3C_ROUND_TRIPS, worst_round_trip);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3c
+
+/**************************************************************************
+
+ Test3d
+
+ Page fault rate.  Two processes hammer a skewed set of pages, the way
+ test2f does, while a third one sweeps sequentially through its address
+ space, the way test2e does.  Together they want several times more
+ memory than there is, so pages are replaced all the time.  Each one
+ reports how many page faults it took per 1,000 memory accesses under
+ the -pager= policy in use.
+
+ Z502_REG1 - Z502_REG3  PIDs of the workload processes
+ Z502_REG9              Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3D                 10
+#define         TEST3Z_ACCESSES             1200
+#define         TEST3W_PASSES               3
+
+void test3d(void) {
+    static long   sleep_time = 1000;
+
+    printf("This is Release %s:  Test 3d\n", CURRENT_REL);
+    CREATE_PROCESS("test3d_skew1", test3z, PRIORITY_3D, &Z502_REG1, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3d_skew2", test3z, PRIORITY_3D, &Z502_REG2, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3d_scan", test3w, PRIORITY_3D, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    // Wait until everyone in the workload is gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        GET_PROCESS_ID("test3d_skew1", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3d_skew2", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3d_scan", &Z502_REG6, &Z502_REG9);
+    }
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3d
+
+/**************************************************************************
+
+ Test3e  Keeps a small interactive process's pages in memory while two
+ other processes sweep through all of theirs.
+
+ test3v has only a few pages it uses all the time, and sleeps between
+ rounds the way an interactive process does.  The two test3w processes
+ next to it scan their whole address space and would take all of memory
+ if they could.  test3v is given a minimum resident set big enough for
+ its pages and one scanner is held to a maximum, using
+ SET_RESIDENT_LIMITS.  Everyone reports its page faults per 1,000
+ accesses, so the -pager= policies can be compared.
+
+ Z502_REG1 - Z502_REG3  PIDs of the workload processes
+ Z502_REG9              Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3E                 10
+#define         TEST3V_HOT_PAGES            12
+#define         TEST3V_ROUNDS               5
+#define         TEST3V_SLEEP                8000
+#define         TEST3E_SCAN_MAX             16
+
+void test3e(void) {
+    static long   sleep_time = 1000;
+
+    printf("This is Release %s:  Test 3e\n", CURRENT_REL);
+    CREATE_PROCESS("test3e_hot", test3v, PRIORITY_3E, &Z502_REG1, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+    SET_RESIDENT_LIMITS(Z502_REG1, TEST3V_HOT_PAGES, 0, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "SET_RESIDENT_LIMITS");
+
+    CREATE_PROCESS("test3e_scan1", test3w, PRIORITY_3E, &Z502_REG2, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+    SET_RESIDENT_LIMITS(Z502_REG2, 0, TEST3E_SCAN_MAX, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "SET_RESIDENT_LIMITS");
+
+    CREATE_PROCESS("test3e_scan2", test3w, PRIORITY_3E, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    // A maximum smaller than the minimum makes no sense
+    SET_RESIDENT_LIMITS(Z502_REG3, 8, 4, &Z502_REG9);
+    ErrorExpected(Z502_REG9, "SET_RESIDENT_LIMITS");
+
+    // Wait until everyone in the workload is gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        GET_PROCESS_ID("test3e_hot", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3e_scan1", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3e_scan2", &Z502_REG6, &Z502_REG9);
+    }
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3e
+
+/**************************************************************************
+
+ Test3f  Runs processes that between them use several times more pages
+ than there are frames, and checks every page comes back from swap with
+ what was written to it.
+
+ Each test3u process writes a pattern to TEST3U_PAGES pages, then goes
+ back over them checking the pattern and writing a new one, and checks
+ that one on a last pass.  Pages are pushed out to swap and read back
+ in the whole time.
+
+ Z502_REG1 - Z502_REG3  PIDs of the workload processes
+ Z502_REG9              Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3F                 10
+#define         TEST3U_PAGES                256
+
+void test3f(void) {
+    static long   sleep_time = 1000;
+
+    printf("This is Release %s:  Test 3f\n", CURRENT_REL);
+    CREATE_PROCESS("test3f_a", test3u, PRIORITY_3F, &Z502_REG1, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3f_b", test3u, PRIORITY_3F, &Z502_REG2, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    CREATE_PROCESS("test3f_c", test3u, PRIORITY_3F, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+
+    // Wait until everyone in the workload is gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        GET_PROCESS_ID("test3f_a", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3f_b", &Z502_REG6, &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS)
+            GET_PROCESS_ID("test3f_c", &Z502_REG6, &Z502_REG9);
+    }
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3f
+
+/**************************************************************************
+
+ Test3g  Makes copies of itself that share its memory copy on write, and
+ touches memory sparsely.
+
+ It writes a template to TEST3G_TEMPLATE pages and reads one word from
+ each of TEST3G_SPARSE pages it never wrote, which should all read as
+ zeros.  Then it starts TEST3G_COPIES copies of itself with
+ CREATE_PROCESS_COPY, each running test3s.  Once they are gone it checks
+ that none of what they wrote found its way into the template.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3G                 10
+#define         TEST3G_TEMPLATE             32
+#define         TEST3G_SPARSE               128
+#define         TEST3G_SPARSE_START         256
+#define         TEST3G_SPARSE_STEP          4
+#define         TEST3G_COPIES               4
+#define         TEST3G_SEED                 7
+
+void test3g(void) {
+    static long   sleep_time = 1000;
+    long   Errors = 0;
+    int    Page;
+    int    Copy;
+    static char process_name[16];
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3g: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Page = 0; Page < TEST3G_TEMPLATE; Page++) {
+        Z502_REG3 = PGSIZE * Page;
+        Z502_REG1 = Z502_REG3 + TEST3G_SEED;
+        MEM_WRITE(Z502_REG3, &Z502_REG1);
+    }
+
+    for (Page = 0; Page < TEST3G_SPARSE; Page++) {
+        Z502_REG3 = PGSIZE * (TEST3G_SPARSE_START + Page * TEST3G_SPARSE_STEP);
+        MEM_READ(Z502_REG3, &Z502_REG2);
+        if (Z502_REG2 != 0) {
+            printf("AN ERROR HAS OCCURRED: untouched page %ld held %ld\n", Z502_REG3 / PGSIZE, Z502_REG2);
+            Errors++;
+        }
+    }
+
+    for (Copy = 0; Copy < TEST3G_COPIES; Copy++) {
+        sprintf(process_name, "test3g_%d", Copy);
+        CREATE_PROCESS_COPY(process_name, test3s, PRIORITY_3G, &Z502_REG1, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "CREATE_PROCESS_COPY");
+    }
+
+    // Wait until all the copies are gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        Z502_REG9 = ~ERR_SUCCESS;
+        for (Copy = 0; Copy < TEST3G_COPIES && Z502_REG9 != ERR_SUCCESS; Copy++) {
+            sprintf(process_name, "test3g_%d", Copy);
+            GET_PROCESS_ID(process_name, &Z502_REG6, &Z502_REG9);
+        }
+    }
+
+    // the copies wrote to their own pages, never to ours
+    for (Page = 0; Page < TEST3G_TEMPLATE; Page++) {
+        Z502_REG3 = PGSIZE * Page;
+        MEM_READ(Z502_REG3, &Z502_REG2);
+        if (Z502_REG2 != Z502_REG3 + TEST3G_SEED) {
+            printf("AN ERROR HAS OCCURRED: template page %d held %ld, expected %ld\n",
+                    Page, Z502_REG2, Z502_REG3 + TEST3G_SEED);
+            Errors++;
+        }
+    }
+    printf("Test3g, PID %ld, %ld errors\n", Z502_REG4, Errors);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3g
+
+/**************************************************************************
+
+ Test3h  Puts a heavy load on one disk, in the style of test2c.
+
+ TEST3H_WORKERS copies of test3r all write and read back sectors spread
+ over the same disk, so there is always a queue for the disk scheduling
+ policy to put in order.  Each reports how long its transfers took, and
+ this test reports when they were all done.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3H                 10
+#define         TEST3H_WORKERS              6
+#define         TEST3H_DISK                 1
+#define         TEST3R_LOOPS                40
+#define         TEST3R_SPREAD               16
+
+void test3h(void) {
+    static long   sleep_time = 1000;
+    int    Worker;
+    static char process_name[16];
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3h: Pid %ld\n", CURRENT_REL, Z502_REG4);
+    GET_TIME_OF_DAY(&Z502_REG7);
+
+    for (Worker = 0; Worker < TEST3H_WORKERS; Worker++) {
+        sprintf(process_name, "test3h_%d", Worker);
+        CREATE_PROCESS(process_name, test3r, PRIORITY_3H, &Z502_REG1, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+    }
+
+    // Wait until all the workers are gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        Z502_REG9 = ~ERR_SUCCESS;
+        for (Worker = 0; Worker < TEST3H_WORKERS && Z502_REG9 != ERR_SUCCESS; Worker++) {
+            sprintf(process_name, "test3h_%d", Worker);
+            GET_PROCESS_ID(process_name, &Z502_REG6, &Z502_REG9);
+        }
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3h, %d transfers in %ld ticks, Ends at Time %ld\n",
+            TEST3H_WORKERS * TEST3R_LOOPS * 2, Z502_REG8 - Z502_REG7, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3h
+
+/**************************************************************************
+
+ Test3i  Writes the same few sectors over and over, the way test2c's
+ loops do, and makes sure they got to the disk with FLUSH_DISK.
+
+ TEST3I_WORKERS copies of test3q each keep TEST3Q_SECTORS sectors of
+ their own on TEST3I_DISK up to date, writing each of them
+ TEST3Q_ROUNDS times.  This test reports when they were all done.
+ Run it with the buffer cache on (e.g. -cache_buffers=64) and compare
+ how many writes the halt statistics show merged.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3I                 10
+#define         TEST3I_WORKERS              4
+#define         TEST3I_DISK                 2
+#define         TEST3Q_SECTORS              8
+#define         TEST3Q_ROUNDS               20
+
+void test3i(void) {
+    static long   sleep_time = 1000;
+    int    Worker;
+    static char process_name[16];
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3i: Pid %ld\n", CURRENT_REL, Z502_REG4);
+    GET_TIME_OF_DAY(&Z502_REG7);
+
+    for (Worker = 0; Worker < TEST3I_WORKERS; Worker++) {
+        sprintf(process_name, "test3i_%d", Worker);
+        CREATE_PROCESS(process_name, test3q, PRIORITY_3I, &Z502_REG1, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+    }
+
+    // Wait until all the workers are gone
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(sleep_time);
+        Z502_REG9 = ~ERR_SUCCESS;
+        for (Worker = 0; Worker < TEST3I_WORKERS && Z502_REG9 != ERR_SUCCESS; Worker++) {
+            sprintf(process_name, "test3i_%d", Worker);
+            GET_PROCESS_ID(process_name, &Z502_REG6, &Z502_REG9);
+        }
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3i, %d writes in %ld ticks, Ends at Time %ld\n",
+            TEST3I_WORKERS * TEST3Q_SECTORS * TEST3Q_ROUNDS, Z502_REG8 - Z502_REG7, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3i
+
+/**************************************************************************
+
+ Test3j  Keeps all the disks busy from one process with DISK_READ_ASYNC
+ and DISK_WRITE_ASYNC.
+
+ The disks are the TEST3J_DISKS below the swap disks, which a process
+ can't get at.  It writes two sets of TEST3J_ROUNDS sectors on every
+ disk, one sector per disk at a time, then reads the first set back
+ with DISK_READ and the second with DISK_READ_ASYNC, and reports how
+ long each took.  Last it writes a sector on every disk asking to be
+ told through its mailbox, and collects the messages.
+
+ Reading a sector on every disk at once is nowhere near eight times
+ as fast.  Starting a transfer and collecting it cost the process CPU
+ time of its own, so one process issuing reads can go no faster than
+ a DISK_READ takes over what those two calls take, however many disks
+ it has.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         TEST3J_ROUNDS               4
+#define         TEST3J_SPACING              100
+#define         TEST3J_DISKS                (MAX_NUMBER_OF_DISKS - 4)   // the ones under the default swap disks
+
+void test3j(void) {
+    static DISK_DATA  data_written[TEST3J_DISKS + 1];
+    static DISK_DATA  data_read[TEST3J_DISKS + 1];
+    long       handle[TEST3J_DISKS + 1];
+    INT32      completion[4];
+    long       Errors = 0;
+    long       sync_time;
+    long       async_time;
+    long       done;
+    int        Set;
+    int        Round;
+    long       Disk;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3j: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    // Write both sets, every disk at once
+    for (Set = 0; Set < 2; Set++) {
+        for (Round = 0; Round < TEST3J_ROUNDS; Round++) {
+            for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+                Z502_REG5 = (Round * 2 + Set) * TEST3J_SPACING + Disk;
+                data_written[Disk].int_data[0] = Disk;
+                data_written[Disk].int_data[1] = Z502_REG5;
+                data_written[Disk].int_data[2] = Z502_REG4;
+                DISK_WRITE_ASYNC(Disk, Z502_REG5, (char* )(data_written[Disk].char_data),
+                        FALSE, &handle[Disk], &Z502_REG9);
+                SuccessExpected(Z502_REG9, "DISK_WRITE_ASYNC");
+            }
+            for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+                DISK_WAIT(handle[Disk], &Z502_REG9);
+                SuccessExpected(Z502_REG9, "DISK_WAIT");
+            }
+        }
+    }
+
+    // The first set one sector at a time
+    GET_TIME_OF_DAY(&Z502_REG7);
+    for (Round = 0; Round < TEST3J_ROUNDS; Round++) {
+        for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+            Z502_REG5 = (Round * 2) * TEST3J_SPACING + Disk;
+            DISK_READ(Disk, Z502_REG5, (char* )(data_read[Disk].char_data));
+            if (data_read[Disk].int_data[0] != Disk || data_read[Disk].int_data[1] != Z502_REG5) {
+                printf("AN ERROR HAS OCCURRED: disk %ld sector %ld read back wrong\n", Disk, Z502_REG5);
+                Errors++;
+            }
+        }
+    }
+    GET_TIME_OF_DAY(&Z502_REG8);
+    sync_time = Z502_REG8 - Z502_REG7;
+
+    // The second set a sector on every disk at a time, taking them as they finish
+    GET_TIME_OF_DAY(&Z502_REG7);
+    for (Round = 0; Round < TEST3J_ROUNDS; Round++) {
+        for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+            Z502_REG5 = (Round * 2 + 1) * TEST3J_SPACING + Disk;
+            DISK_READ_ASYNC(Disk, Z502_REG5, (char* )(data_read[Disk].char_data),
+                    FALSE, &handle[Disk], &Z502_REG9);
+            SuccessExpected(Z502_REG9, "DISK_READ_ASYNC");
+        }
+
+        DISK_POLL(handle[1], &done, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "DISK_POLL");
+
+        for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+            DISK_WAIT_ANY(&Z502_REG6, &Z502_REG9);
+            SuccessExpected(Z502_REG9, "DISK_WAIT_ANY");
+        }
+        for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+            Z502_REG5 = (Round * 2 + 1) * TEST3J_SPACING + Disk;
+            if (data_read[Disk].int_data[0] != Disk || data_read[Disk].int_data[1] != Z502_REG5) {
+                printf("AN ERROR HAS OCCURRED: disk %ld sector %ld read back wrong\n", Disk, Z502_REG5);
+                Errors++;
+            }
+        }
+    }
+    GET_TIME_OF_DAY(&Z502_REG8);
+    async_time = Z502_REG8 - Z502_REG7;
+
+    // Nothing is left, so there is nothing to wait for
+    DISK_WAIT_ANY(&Z502_REG6, &Z502_REG9);
+    ErrorExpected(Z502_REG9, "DISK_WAIT_ANY");
+
+    // Hear about these through the mailbox
+    for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+        Z502_REG5 = TEST3J_ROUNDS * 2 * TEST3J_SPACING + Disk;
+        DISK_WRITE_ASYNC(Disk, Z502_REG5, (char* )(data_written[Disk].char_data), TRUE,
+                &handle[Disk], &Z502_REG9);
+        SuccessExpected(Z502_REG9, "DISK_WRITE_ASYNC");
+    }
+    for (Disk = 1; Disk <= TEST3J_DISKS; Disk++) {
+        RECEIVE_MESSAGE(Z502_REG4, (char* )completion, sizeof(completion), &Z502_REG2, &Z502_REG3, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "RECEIVE_MESSAGE");
+        if (completion[0] != handle[completion[1]] || completion[2] != TEST3J_ROUNDS * 2 * TEST3J_SPACING + completion[1]) {
+            printf("AN ERROR HAS OCCURRED: completion for handle %d, disk %d, sector %d is wrong\n",
+                    completion[0], completion[1], completion[2]);
+            Errors++;
+        }
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3j, %d reads one at a time in %ld ticks, %d at once in %ld ticks, %ld errors, Ends at Time %ld\n",
+            TEST3J_ROUNDS * TEST3J_DISKS, sync_time, TEST3J_ROUNDS * TEST3J_DISKS, async_time,
+            Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3j
+
+/**************************************************************************
+
+ Test3k  Moves records of TEST3K_SECTORS sectors with DISK_WRITEV and
+ DISK_READV, and the same sized records a sector at a time.
+
+ One record is written with DISK_WRITEV, another a sector at a time
+ with DISK_WRITE followed by FLUSH_DISK, so both are on the disk.  Then
+ the first is read back a sector at a time and the second with
+ DISK_READV.  Last a record striped over TEST3K_STRIPE disks is written
+ and read back with one call each way.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         TEST3K_SECTORS              64
+#define         TEST3K_DISK                 3
+#define         TEST3K_VECTOR_START         200
+#define         TEST3K_LOOP_START           600
+#define         TEST3K_STRIPE               4
+#define         TEST3K_STRIPE_START         900
+
+void test3k(void) {
+    static DISK_DATA    record[TEST3K_SECTORS];
+    static DISK_DATA    read_back[TEST3K_SECTORS];
+    static DISK_SEGMENT segment[TEST3K_SECTORS];
+    long       Errors = 0;
+    long       vector_write_time;
+    long       loop_write_time;
+    long       vector_read_time;
+    long       loop_read_time;
+    long       stripe_write_time;
+    long       stripe_read_time;
+    int        Sector;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3k: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    // Both records, one sector at a time and all at once
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        segment[Sector].disk_id = TEST3K_DISK;
+        segment[Sector].sector_id = TEST3K_VECTOR_START + Sector;
+        segment[Sector].buffer = (char*) record[Sector].char_data;
+        record[Sector].int_data[0] = TEST3K_DISK;
+        record[Sector].int_data[1] = TEST3K_VECTOR_START + Sector;
+        record[Sector].int_data[2] = Z502_REG4;
+    }
+    GET_TIME_OF_DAY(&Z502_REG7);
+    DISK_WRITEV(segment, TEST3K_SECTORS, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    SuccessExpected(Z502_REG9, "DISK_WRITEV");
+    vector_write_time = Z502_REG8 - Z502_REG7;
+
+    GET_TIME_OF_DAY(&Z502_REG7);
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        Z502_REG5 = TEST3K_LOOP_START + Sector;
+        record[Sector].int_data[1] = Z502_REG5;
+        DISK_WRITE(TEST3K_DISK, Z502_REG5, (char* )(record[Sector].char_data));
+    }
+    FLUSH_DISK(TEST3K_DISK, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    SuccessExpected(Z502_REG9, "FLUSH_DISK");
+    loop_write_time = Z502_REG8 - Z502_REG7;
+
+    // Read each back the other way
+    GET_TIME_OF_DAY(&Z502_REG7);
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        Z502_REG5 = TEST3K_VECTOR_START + Sector;
+        DISK_READ(TEST3K_DISK, Z502_REG5, (char* )(read_back[Sector].char_data));
+    }
+    GET_TIME_OF_DAY(&Z502_REG8);
+    loop_read_time = Z502_REG8 - Z502_REG7;
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        if (read_back[Sector].int_data[1] != TEST3K_VECTOR_START + Sector) {
+            printf("AN ERROR HAS OCCURRED: sector %d of the DISK_WRITEV record read back wrong\n", Sector);
+            Errors++;
+        }
+    }
+
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        segment[Sector].sector_id = TEST3K_LOOP_START + Sector;
+        segment[Sector].buffer = (char*) read_back[Sector].char_data;
+    }
+    GET_TIME_OF_DAY(&Z502_REG7);
+    DISK_READV(segment, TEST3K_SECTORS, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    SuccessExpected(Z502_REG9, "DISK_READV");
+    vector_read_time = Z502_REG8 - Z502_REG7;
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        if (read_back[Sector].int_data[1] != TEST3K_LOOP_START + Sector) {
+            printf("AN ERROR HAS OCCURRED: sector %d of the DISK_WRITE record read back wrong\n", Sector);
+            Errors++;
+        }
+    }
+
+    // A record spread over several disks
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        segment[Sector].disk_id = 1 + Sector % TEST3K_STRIPE;
+        segment[Sector].sector_id = TEST3K_STRIPE_START + Sector / TEST3K_STRIPE;
+        segment[Sector].buffer = (char*) record[Sector].char_data;
+        record[Sector].int_data[0] = segment[Sector].disk_id;
+        record[Sector].int_data[1] = segment[Sector].sector_id;
+    }
+    GET_TIME_OF_DAY(&Z502_REG7);
+    DISK_WRITEV(segment, TEST3K_SECTORS, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    SuccessExpected(Z502_REG9, "DISK_WRITEV");
+    stripe_write_time = Z502_REG8 - Z502_REG7;
+
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++)
+        segment[Sector].buffer = (char*) read_back[Sector].char_data;
+    GET_TIME_OF_DAY(&Z502_REG7);
+    DISK_READV(segment, TEST3K_SECTORS, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    SuccessExpected(Z502_REG9, "DISK_READV");
+    stripe_read_time = Z502_REG8 - Z502_REG7;
+    for (Sector = 0; Sector < TEST3K_SECTORS; Sector++) {
+        if (read_back[Sector].int_data[0] != segment[Sector].disk_id
+                || read_back[Sector].int_data[1] != segment[Sector].sector_id) {
+            printf("AN ERROR HAS OCCURRED: sector %d of the striped record read back wrong\n", Sector);
+            Errors++;
+        }
+    }
+
+    // Too many segments is an error
+    DISK_READV(segment, MAX_DISK_SEGMENTS + 1, &Z502_REG9);
+    ErrorExpected(Z502_REG9, "DISK_READV");
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3k, %d sector records: write %ld ticks a sector at a time, %ld vectored; "
+            "read %ld a sector at a time, %ld vectored\n",
+            TEST3K_SECTORS, loop_write_time, vector_write_time, loop_read_time, vector_read_time);
+    printf("Test3k, striped over %d disks: write %ld, read %ld, %ld errors, Ends at Time %ld\n",
+            TEST3K_STRIPE, stripe_write_time, stripe_read_time, Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3k
+
+/**************************************************************************
+
+ Test3l  Commits transactions to a journal the way a file system does,
+ with FLUSH_DISK after each step.
+
+ Each of TEST3L_TRANSACTIONS transactions writes TEST3L_BLOCKS sectors
+ to the journal and calls FLUSH_DISK so they are on the disk, then
+ writes a commit record and calls FLUSH_DISK again.  Once it commits,
+ the same blocks are written to their home sectors with no flush, and
+ last everything is read back.  How long a commit takes depends on
+ whether the disk has a write cache, and how FLUSH_DISK gets past it.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         TEST3L_TRANSACTIONS         20
+#define         TEST3L_BLOCKS               4
+#define         TEST3L_DISK                 5
+#define         TEST3L_JOURNAL_START        100
+#define         TEST3L_HOME_START           700
+
+void test3l(void) {
+    DISK_DATA  block;
+    DISK_DATA  read_back;
+    long       Errors = 0;
+    long       commit_time = 0;
+    int        Transaction;
+    int        Block;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3l: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Transaction = 0; Transaction < TEST3L_TRANSACTIONS; Transaction++) {
+        // The journal, then the commit record, each made durable in turn
+        GET_TIME_OF_DAY(&Z502_REG7);
+        for (Block = 0; Block < TEST3L_BLOCKS; Block++) {
+            Z502_REG5 = TEST3L_JOURNAL_START + Transaction * (TEST3L_BLOCKS + 1) + Block;
+            block.int_data[0] = Transaction;
+            block.int_data[1] = Block;
+            DISK_WRITE(TEST3L_DISK, Z502_REG5, (char* )(block.char_data));
+        }
+        FLUSH_DISK(TEST3L_DISK, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "FLUSH_DISK");
+        Z502_REG5 = TEST3L_JOURNAL_START + Transaction * (TEST3L_BLOCKS + 1) + TEST3L_BLOCKS;
+        block.int_data[0] = Transaction;
+        block.int_data[1] = -1;
+        DISK_WRITE(TEST3L_DISK, Z502_REG5, (char* )(block.char_data));
+        FLUSH_DISK(TEST3L_DISK, &Z502_REG9);
+        GET_TIME_OF_DAY(&Z502_REG8);
+        SuccessExpected(Z502_REG9, "FLUSH_DISK");
+        commit_time += Z502_REG8 - Z502_REG7;
+
+        // Checkpoint the blocks where they belong, whenever they get there
+        for (Block = 0; Block < TEST3L_BLOCKS; Block++) {
+            Z502_REG5 = TEST3L_HOME_START + Transaction * TEST3L_BLOCKS + Block;
+            block.int_data[0] = Transaction;
+            block.int_data[1] = Block;
+            DISK_WRITE(TEST3L_DISK, Z502_REG5, (char* )(block.char_data));
+        }
+    }
+
+    for (Transaction = 0; Transaction < TEST3L_TRANSACTIONS; Transaction++) {
+        Z502_REG5 = TEST3L_JOURNAL_START + Transaction * (TEST3L_BLOCKS + 1) + TEST3L_BLOCKS;
+        DISK_READ(TEST3L_DISK, Z502_REG5, (char* )(read_back.char_data));
+        if (read_back.int_data[0] != Transaction || read_back.int_data[1] != -1) {
+            printf("AN ERROR HAS OCCURRED: commit record %d read back wrong\n", Transaction);
+            Errors++;
+        }
+        for (Block = 0; Block < TEST3L_BLOCKS; Block++) {
+            Z502_REG5 = TEST3L_HOME_START + Transaction * TEST3L_BLOCKS + Block;
+            DISK_READ(TEST3L_DISK, Z502_REG5, (char* )(read_back.char_data));
+            if (read_back.int_data[0] != Transaction || read_back.int_data[1] != Block) {
+                printf("AN ERROR HAS OCCURRED: block %d of transaction %d read back wrong\n",
+                        Block, Transaction);
+                Errors++;
+            }
+        }
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3l, %d transactions of %d blocks: %ld ticks a commit, %ld errors, Ends at Time %ld\n",
+            TEST3L_TRANSACTIONS, TEST3L_BLOCKS, commit_time / TEST3L_TRANSACTIONS, Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3l
+
+/**************************************************************************
+
+ Test3m  Measures a volume: how long it takes to move a lot of sectors,
+ and how long reads wait when a burst of them arrives at once.
+
+ Run it with -volume= so there is a volume for it to use, the first,
+ which answers to disk MAX_NUMBER_OF_DISKS + 1.  The more members it
+ has, the less either should take.  TEST3M_SECTORS sectors
+ TEST3M_SPACING apart are written with one DISK_WRITEV and read back
+ with one DISK_READV; the spacing is a prime bigger than any number of
+ members, so they are dealt out evenly on RAID-0.  Then TEST3M_BURSTS
+ times TEST3M_BURST of them, picked at random, are read with
+ DISK_READ_ASYNC, and taken as they finish to see how long each took.
+
+ Writes to RAID-1 don't get faster with more members, since every one
+ of them gets each sector.  Reads do with -mirror_read=busy, since a
+ burst is shared out over more of them.  With -mirror_read=near the
+ heads all start together, so the pieces of one DISK_READV mostly go
+ to the same member, and it reads no faster on four members than on
+ two.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         TEST3M_VOLUME               (MAX_NUMBER_OF_DISKS + 1)
+#define         TEST3M_SECTORS              64
+#define         TEST3M_SPACING              23
+#define         TEST3M_BURSTS               8
+#define         TEST3M_BURST                8
+
+void test3m(void) {
+    static DISK_DATA    record[TEST3M_SECTORS];
+    static DISK_DATA    read_back[TEST3M_SECTORS];
+    static DISK_SEGMENT segment[TEST3M_SECTORS];
+    long       handle[TEST3M_BURST];
+    long       sector_read[TEST3M_BURST];
+    long       Errors = 0;
+    long       write_time;
+    long       read_time;
+    long       latency_total = 0;
+    int        Sector;
+    int        Burst;
+    int        Read;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3m: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Sector = 0; Sector < TEST3M_SECTORS; Sector++) {
+        segment[Sector].disk_id = TEST3M_VOLUME;
+        segment[Sector].sector_id = Sector * TEST3M_SPACING;
+        segment[Sector].buffer = (char*) record[Sector].char_data;
+        record[Sector].int_data[0] = TEST3M_VOLUME;
+        record[Sector].int_data[1] = Sector * TEST3M_SPACING;
+        record[Sector].int_data[2] = Z502_REG4;
+    }
+    GET_TIME_OF_DAY(&Z502_REG7);
+    DISK_WRITEV(segment, TEST3M_SECTORS, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    if (Z502_REG9 != ERR_SUCCESS) {
+        printf("Test3m needs a volume; run it with -volume=raid0:1-4 or the like\n");
+        TERMINATE_PROCESS(-2, &Z502_REG9);
+    }
+    write_time = Z502_REG8 - Z502_REG7;
+
+    for (Sector = 0; Sector < TEST3M_SECTORS; Sector++)
+        segment[Sector].buffer = (char*) read_back[Sector].char_data;
+    GET_TIME_OF_DAY(&Z502_REG7);
+    DISK_READV(segment, TEST3M_SECTORS, &Z502_REG9);
+    GET_TIME_OF_DAY(&Z502_REG8);
+    SuccessExpected(Z502_REG9, "DISK_READV");
+    read_time = Z502_REG8 - Z502_REG7;
+    for (Sector = 0; Sector < TEST3M_SECTORS; Sector++) {
+        if (read_back[Sector].int_data[1] != Sector * TEST3M_SPACING) {
+            printf("AN ERROR HAS OCCURRED: sector %d read back wrong\n", Sector * TEST3M_SPACING);
+            Errors++;
+        }
+    }
+
+    // Bursts of reads all over the volume, timed from when each burst starts
+    for (Burst = 0; Burst < TEST3M_BURSTS; Burst++) {
+        GET_TIME_OF_DAY(&Z502_REG7);
+        for (Read = 0; Read < TEST3M_BURST; Read++) {
+            sector_read[Read] = (rand() % TEST3M_SECTORS) * TEST3M_SPACING;
+            DISK_READ_ASYNC(TEST3M_VOLUME, sector_read[Read], (char* )(read_back[Read].char_data),
+                    FALSE, &handle[Read], &Z502_REG9);
+            SuccessExpected(Z502_REG9, "DISK_READ_ASYNC");
+        }
+        for (Read = 0; Read < TEST3M_BURST; Read++) {
+            DISK_WAIT_ANY(&Z502_REG6, &Z502_REG9);
+            SuccessExpected(Z502_REG9, "DISK_WAIT_ANY");
+            GET_TIME_OF_DAY(&Z502_REG8);
+            latency_total += Z502_REG8 - Z502_REG7;
+        }
+        for (Read = 0; Read < TEST3M_BURST; Read++) {
+            if (read_back[Read].int_data[1] != sector_read[Read]) {
+                printf("AN ERROR HAS OCCURRED: sector %ld read back wrong\n", sector_read[Read]);
+                Errors++;
+            }
+        }
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3m, %d sectors: written in %ld ticks, read in %ld; reads %d at a time wait %ld on average\n",
+            TEST3M_SECTORS, write_time, read_time, TEST3M_BURST, latency_total / (TEST3M_BURSTS * TEST3M_BURST));
+    printf("Test3m, %ld errors, Ends at Time %ld\n", Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3m
+
+/**************************************************************************
+
+ Test3n  Reads back a region that was paged out, front to back, the way
+ a process streams through a big array.  Compare runs with -readahead=0
+ and the default.
+
+ TEST3N_PAGES pages, several times the default memory, are written
+ first so most of them end up on swap.  Then they are read back
+ TEST3N_PASSES times in order, with TEST3N_TOUCHES reads on each page,
+ the work a stream does between faults.  With read-ahead on, the next
+ pages are on their way in from the other swap disks while it works,
+ so fewer of the reads fault.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         TEST3N_PAGES                256
+#define         TEST3N_PASSES               3
+#define         TEST3N_TOUCHES              16
+
+void test3n(void) {
+    long       Errors = 0;
+    long       write_faults;
+    long       read_time;
+    int        Pass;
+    int        Page;
+    int        Touch;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3n: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Page = 0; Page < TEST3N_PAGES; Page++) {
+        Z502_REG3 = PGSIZE * Page;
+        Z502_REG1 = Page + Z502_REG4;
+        MEM_WRITE(Z502_REG3, &Z502_REG1);
+    }
+    GET_PAGE_FAULTS(-1, &write_faults, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+
+    GET_TIME_OF_DAY(&Z502_REG7);
+    for (Pass = 0; Pass < TEST3N_PASSES; Pass++) {
+        for (Page = 0; Page < TEST3N_PAGES; Page++) {
+            Z502_REG3 = PGSIZE * Page;
+            MEM_READ(Z502_REG3, &Z502_REG2);
+            if (Z502_REG2 != Page + Z502_REG4) {
+                printf("AN ERROR HAS OCCURRED: page %d read back %ld\n", Page, Z502_REG2);
+                Errors++;
+            }
+            for (Touch = 1; Touch < TEST3N_TOUCHES; Touch++) {
+                Z502_REG3 = PGSIZE * Page + (Touch * PGSIZE / TEST3N_TOUCHES);
+                MEM_READ(Z502_REG3, &Z502_REG2);
+            }
+        }
+    }
+    GET_TIME_OF_DAY(&Z502_REG8);
+    read_time = Z502_REG8 - Z502_REG7;
+
+    GET_PAGE_FAULTS(-1, &Z502_REG5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+    printf("Test3n, %d pages read %d times: %ld page faults in %ld ticks\n",
+            TEST3N_PAGES, TEST3N_PASSES, Z502_REG5 - write_faults, read_time);
+    printf("Test3n, %ld errors, Ends at Time %ld\n", Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3n
+
+/**************************************************************************
+
+ Test3o  Checks a solid state disk: that it works on several transfers
+ at once, that a sector never written reads back as zeros, and that
+ swap trimming the sectors it gives back leaves other disks alone.
+
+ Run it with -ssd_disks=2 -swap_disks=1, so the swap area is one solid
+ state disk and TEST3O_DISK, the one under it, is the other.  First
+ TEST3O_WRITES sectors at the top of TEST3O_DISK are written with
+ DISK_WRITE_ASYNC all at once.  One channel would need TEST3O_WRITES
+ times SSD_WRITE_TIME to write them, so taking less than that means
+ the channels overlapped; taking as long as a spinning disk would means
+ it isn't a solid state disk.  The first TEST3O_SCAN sectors, never
+ written, should read back as zeros over what the buffer held.  Then
+ test3t writes TEST3O_PAGES pages, more than fit in memory, so most of
+ them go out to swap, and checks them.  Once it is gone, swap trims
+ their sectors; the statistics at the end say how many.  The sectors
+ written at the start should still be there.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         PRIORITY_3O                 10
+#define         TEST3O_DISK                 (MAX_NUMBER_OF_DISKS - 1)
+#define         TEST3O_WRITES               16
+#define         TEST3O_SPIN_TIME            100     // the least a spinning disk write takes
+#define         TEST3O_PAGES                256
+#define         TEST3O_SCAN                 64
+#define         TEST3O_SETTLE               200
+
+void test3o(void) {
+    static DISK_DATA  data_written[TEST3O_WRITES];
+    DISK_DATA  data_read;
+    long       handle[TEST3O_WRITES];
+    long       Errors = 0;
+    long       write_time;
+    long       unwritten;
+    long       Child;
+    int        Write;
+    long       Sector;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3o: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    // Every channel at once
+    GET_TIME_OF_DAY(&Z502_REG7);
+    for (Write = 0; Write < TEST3O_WRITES; Write++) {
+        data_written[Write].int_data[0] = TEST3O_DISK;
+        data_written[Write].int_data[1] = NUM_LOGICAL_SECTORS - 1 - Write;
+        DISK_WRITE_ASYNC(TEST3O_DISK, NUM_LOGICAL_SECTORS - 1 - Write, (char* )(data_written[Write].char_data),
+                FALSE, &handle[Write], &Z502_REG9);
+        if (Z502_REG9 != ERR_SUCCESS) {
+            printf("Test3o can't write disk %d, it must be a swap disk; run it with -ssd_disks=2 -swap_disks=1\n",
+                    TEST3O_DISK);
+            TERMINATE_PROCESS(-2, &Z502_REG9);
+        }
+    }
+    for (Write = 0; Write < TEST3O_WRITES; Write++) {
+        DISK_WAIT_ANY(&Z502_REG6, &Z502_REG9);
+        SuccessExpected(Z502_REG9, "DISK_WAIT_ANY");
+    }
+    GET_TIME_OF_DAY(&Z502_REG8);
+    write_time = Z502_REG8 - Z502_REG7;
+    if (write_time >= TEST3O_WRITES * TEST3O_SPIN_TIME) {
+        printf("Test3o needs solid state disks; run it with -ssd_disks=2 -swap_disks=1\n");
+        TERMINATE_PROCESS(-2, &Z502_REG9);
+    }
+    if (write_time >= TEST3O_WRITES * SSD_WRITE_TIME) {
+        printf("AN ERROR HAS OCCURRED: %d writes took %ld ticks, so they didn't overlap\n",
+                TEST3O_WRITES, write_time);
+        Errors++;
+    }
+
+    // Nothing was ever written here
+    unwritten = 0;
+    for (Sector = 0; Sector < TEST3O_SCAN; Sector++) {
+        memset(data_read.char_data, 0xFF, PGSIZE);
+        DISK_READ(TEST3O_DISK, Sector, (char* )(data_read.char_data));
+        if (data_read.int_data[0] == 0 && data_read.int_data[1] == 0)
+            unwritten++;
+    }
+    if (unwritten != TEST3O_SCAN) {
+        printf("AN ERROR HAS OCCURRED: %ld of %d sectors never written didn't read back as zeros\n",
+                TEST3O_SCAN - unwritten, TEST3O_SCAN);
+        Errors++;
+    }
+
+    // Fill memory from a process of its own, so it can give its swap back
+    CREATE_PROCESS("test3o_1", test3t, PRIORITY_3O, &Child, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "CREATE_PROCESS");
+    SEND_MESSAGE(Child, "go", 3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "SEND_MESSAGE");
+    RECEIVE_MESSAGE(Child, (char* )data_read.char_data, PGSIZE, &Z502_REG2, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "RECEIVE_MESSAGE");
+
+    // Let it go, and give the trims time to get to the swap disk
+    SEND_MESSAGE(Child, "done", 5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "SEND_MESSAGE");
+    Z502_REG9 = ERR_SUCCESS;
+    while (Z502_REG9 == ERR_SUCCESS) {
+        SLEEP(TEST3O_SETTLE);
+        GET_PROCESS_ID("test3o_1", &Z502_REG6, &Z502_REG9);
+    }
+    SLEEP(TEST3O_SETTLE);
+
+    for (Write = 0; Write < TEST3O_WRITES; Write++) {
+        DISK_READ(TEST3O_DISK, NUM_LOGICAL_SECTORS - 1 - Write, (char* )(data_read.char_data));
+        if (data_read.int_data[0] != TEST3O_DISK || data_read.int_data[1] != NUM_LOGICAL_SECTORS - 1 - Write) {
+            printf("AN ERROR HAS OCCURRED: sector %d of disk %d read back wrong\n",
+                    NUM_LOGICAL_SECTORS - 1 - Write, TEST3O_DISK);
+            Errors++;
+        }
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3o, %d writes at once in %ld ticks (one channel needs %ld), %ld of %d unwritten sectors read as zeros\n",
+            TEST3O_WRITES, write_time, TEST3O_WRITES * SSD_WRITE_TIME, unwritten, TEST3O_SCAN);
+    printf("Test3o, %ld errors, Ends at Time %ld\n", Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3o
+
+/**************************************************************************
+
+ Test3p  Checks the track cache of a spinning disk.  Run it with
+ -track_cache=8, so each sector read off the platter brings in the
+ TEST3P_CACHE sectors from it on.
+
+ TEST3P_SECTORS sectors of TEST3P_DISK are written, then read back in
+ order, each read timed on its own.  Nothing comes off the platter in
+ less than TEST3P_MISS_TIME, so a read that does was answered from the
+ cache.  Only the first read of each run of TEST3P_CACHE sectors should
+ miss, and a hit should cost less than a miss.
+
+ Z502_REG4  PID of this process
+ Z502_REG9  Error returned
+
+ **************************************************************************/
+#define         TEST3P_DISK                 1
+#define         TEST3P_SECTORS              64
+#define         TEST3P_CACHE                8
+#define         TEST3P_MISS_TIME            100     // the least a read off the platter takes
+
+void test3p(void) {
+    DISK_DATA  data_written;
+    DISK_DATA  data_read;
+    long       Errors = 0;
+    long       read_time;
+    long       hits = 0;
+    long       hit_time = 0;
+    long       miss_time = 0;
+    long       Sector;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("This is Release %s:  Test 3p: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Sector = 0; Sector < TEST3P_SECTORS; Sector++) {
+        data_written.int_data[0] = TEST3P_DISK;
+        data_written.int_data[1] = Sector;
+        DISK_WRITE(TEST3P_DISK, Sector, (char* )(data_written.char_data));
+    }
+
+    for (Sector = 0; Sector < TEST3P_SECTORS; Sector++) {
+        GET_TIME_OF_DAY(&Z502_REG7);
+        DISK_READ(TEST3P_DISK, Sector, (char* )(data_read.char_data));
+        GET_TIME_OF_DAY(&Z502_REG8);
+        read_time = Z502_REG8 - Z502_REG7;
+        if (data_read.int_data[0] != TEST3P_DISK || data_read.int_data[1] != Sector) {
+            printf("AN ERROR HAS OCCURRED: sector %ld read back %d/%d\n", Sector,
+                    data_read.int_data[0], data_read.int_data[1]);
+            Errors++;
+        }
+        if (read_time < TEST3P_MISS_TIME) {
+            hits++;
+            hit_time += read_time;
+        }
+        else
+            miss_time += read_time;
+    }
+    if (hits == 0) {
+        printf("Test3p needs the track cache; run it with -track_cache=%d\n", TEST3P_CACHE);
+        TERMINATE_PROCESS(-2, &Z502_REG9);
+    }
+
+    if (hits != TEST3P_SECTORS - TEST3P_SECTORS / TEST3P_CACHE) {
+        printf("AN ERROR HAS OCCURRED: %ld reads hit the cache, expected %d\n",
+                hits, TEST3P_SECTORS - TEST3P_SECTORS / TEST3P_CACHE);
+        Errors++;
+    }
+    if (hits == TEST3P_SECTORS
+            || hit_time / hits >= miss_time / (TEST3P_SECTORS - hits)) {
+        printf("AN ERROR HAS OCCURRED: a hit took no less than a miss\n");
+        Errors++;
+    }
+
+    GET_TIME_OF_DAY(&Z502_REG8);
+    printf("Test3p, %ld of %d reads hit the cache, %ld ticks a hit, %ld a miss\n",
+            hits, TEST3P_SECTORS, hit_time / hits,
+            hits < TEST3P_SECTORS ? miss_time / (TEST3P_SECTORS - hits) : 0);
+    printf("Test3p, %ld errors, Ends at Time %ld\n", Errors, Z502_REG8);
+
+    TERMINATE_PROCESS(-2, &Z502_REG9);
+
+}                                                 // End test3p
+
+/**************************************************************************
+
+ Test3x
+
+ A CPU bound process; it asks for the time over and over until it has
+ been alive for TEST3X_RUN_TIME, and never gives up the CPU on its own.
+
+ **************************************************************************/
+
+void test3x(void) {
+    long   Iterations = 0;
+
+    GET_PROCESS_ID("", &Z502_REG2, &Z502_REG9);
+    printf("Release %s:Test 3x: Pid %ld\n", CURRENT_REL, Z502_REG2);
+
+    GET_TIME_OF_DAY(&Z502_REG3);
+    Z502_REG4 = Z502_REG3;
+    while (Z502_REG4 - Z502_REG3 < TEST3X_RUN_TIME) {
+        GET_TIME_OF_DAY(&Z502_REG4);
+        Iterations++;
+    }
+    printf("Test3x, PID %ld, %ld iterations, Ends at Time %ld\n", Z502_REG2,
+            Iterations, Z502_REG4);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3x should be terminated but isn't.\n");
+
+}                                                 // End test3x
+
+/**************************************************************************
+
+ Test3y
+
+ An I/O bound process; it does a short burst of work and then sleeps,
+ over and over.  The response time is how much longer than it asked for
+ it took to get back onto the CPU after each sleep.
+
+ **************************************************************************/
+
+void test3y(void) {
+    int    Iterations;
+    int    Burst;
+    long   TotalResponse = 0;
+    long   WorstResponse = 0;
+
+    GET_PROCESS_ID("", &Z502_REG2, &Z502_REG9);
+    printf("Release %s:Test 3y: Pid %ld\n", CURRENT_REL, Z502_REG2);
+
+    for (Iterations = 0; Iterations < NUMBER_OF_TEST3Y_ITERATIONS;
+            Iterations++) {
+        for (Burst = 0; Burst < TEST3Y_BURST; Burst++)
+            GET_TIME_OF_DAY(&Z502_REG3);
+
+        SLEEP(TEST3Y_SLEEP);
+        GET_TIME_OF_DAY(&Z502_REG4);
+
+        Z502_REG5 = Z502_REG4 - Z502_REG3 - TEST3Y_SLEEP;
+        TotalResponse += Z502_REG5;
+        if (Z502_REG5 > WorstResponse)
+            WorstResponse = Z502_REG5;
+    }
+    printf("Test3y, PID %ld, Average Response = %ld, Worst Response = %ld, Ends at Time %ld\n",
+            Z502_REG2, TotalResponse / NUMBER_OF_TEST3Y_ITERATIONS,
+            WorstResponse, Z502_REG4);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3y should be terminated but isn't.\n");
+
+}                                                 // End test3y
+
+/**************************************************************************
+
+ Test3z
+
+ Touches pages picked by get_skewed_random_number, so a few pages are
+ hot and the rest are used now and then, and reports its page faults
+ per 1,000 accesses.
+
+ **************************************************************************/
+
+void test3z(void) {
+    long   Accesses = 0;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3z: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    while (Accesses < TEST3Z_ACCESSES) {
+        get_skewed_random_number(&Z502_REG7, LOGICAL_PAGES_TO_TOUCH);
+        Z502_REG3 = PGSIZE * Z502_REG7;
+        Z502_REG1 = Z502_REG3 + Z502_REG4;
+
+        // write it about a third of the time, so some pages stay clean
+        if (Accesses % 3 == 0)
+            MEM_WRITE(Z502_REG3, &Z502_REG1);
+        else
+            MEM_READ(Z502_REG3, &Z502_REG2);
+        Accesses++;
+    }
+
+    GET_PAGE_FAULTS(-1, &Z502_REG5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+    printf("Test3z, PID %ld, %ld accesses, %ld page faults, %ld faults per 1000 accesses\n",
+            Z502_REG4, Accesses, Z502_REG5, (Z502_REG5 * 1000) / Accesses);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3z should be terminated but isn't.\n");
+
+}                                                 // End test3z
+
+/**************************************************************************
+
+ Test3w
+
+ Sweeps through its address space a page at a time, writing on the
+ first pass and reading after that, and reports its page faults per
+ 1,000 accesses.  A scan like this has no reuse that fits in memory.
+
+ **************************************************************************/
+
+void test3w(void) {
+    long   Accesses = 0;
+    int    Pass;
+    int    Page;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3w: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Pass = 0; Pass < TEST3W_PASSES; Pass++) {
+        for (Page = 0; Page < VIRTUAL_MEM_PGS; Page += STEP_SIZE) {
+            Z502_REG3 = PGSIZE * Page;
+            Z502_REG1 = Z502_REG3 + Z502_REG4;
+            if (Pass == 0)
+                MEM_WRITE(Z502_REG3, &Z502_REG1);
+            else
+                MEM_READ(Z502_REG3, &Z502_REG2);
+            Accesses++;
+        }
+    }
+
+    GET_PAGE_FAULTS(-1, &Z502_REG5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+    printf("Test3w, PID %ld, %ld accesses, %ld page faults, %ld faults per 1000 accesses\n",
+            Z502_REG4, Accesses, Z502_REG5, (Z502_REG5 * 1000) / Accesses);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3w should be terminated but isn't.\n");
+
+}                                                 // End test3w
+
+/**************************************************************************
+
+ Test3v
+
+ Reads the same TEST3V_HOT_PAGES pages over and over, sleeping a long
+ time after each round, and reports its page faults per 1,000 accesses and how many
+ pages it ended up holding.
+
+ **************************************************************************/
+
+void test3v(void) {
+    long   Accesses = 0;
+    int    Round;
+    int    Page;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3v: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Round = 0; Round < TEST3V_ROUNDS; Round++) {
+        for (Page = 0; Page < TEST3V_HOT_PAGES; Page++) {
+            Z502_REG3 = PGSIZE * Page * STEP_SIZE;
+            MEM_READ(Z502_REG3, &Z502_REG2);
+            Accesses++;
+        }
+        SLEEP(TEST3V_SLEEP);
+    }
+
+    GET_PAGE_FAULTS(-1, &Z502_REG5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+    GET_RESIDENT_SET(-1, &Z502_REG6, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_RESIDENT_SET");
+    printf("Test3v, PID %ld, %ld accesses, %ld page faults, %ld faults per 1000 accesses, %ld pages resident\n",
+            Z502_REG4, Accesses, Z502_REG5, (Z502_REG5 * 1000) / Accesses, Z502_REG6);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3v should be terminated but isn't.\n");
+
+}                                                 // End test3v
+
+/**************************************************************************
+
+ Test3u
+
+ Writes every one of TEST3U_PAGES pages, then reads each back, checks
+ it and writes it again, and checks it once more.  Reports any page
+ that didn't hold what was written to it, and its page faults.
+
+ **************************************************************************/
+
+void test3u(void) {
+    long   Errors = 0;
+    int    Pass;
+    int    Page;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3u: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Pass = 0; Pass < 3; Pass++) {
+        for (Page = 0; Page < TEST3U_PAGES; Page++) {
+            Z502_REG3 = PGSIZE * Page;
+
+            // what the previous pass should have left there
+            if (Pass > 0) {
+                MEM_READ(Z502_REG3, &Z502_REG2);
+                Z502_REG1 = Z502_REG3 + Z502_REG4 * 1000 + (Pass - 1);
+                if (Z502_REG2 != Z502_REG1) {
+                    printf("AN ERROR HAS OCCURRED: PID %ld page %d pass %d held %ld, expected %ld\n",
+                            Z502_REG4, Page, Pass, Z502_REG2, Z502_REG1);
+                    Errors++;
+                }
+            }
+
+            if (Pass < 2) {
+                Z502_REG1 = Z502_REG3 + Z502_REG4 * 1000 + Pass;
+                MEM_WRITE(Z502_REG3, &Z502_REG1);
+            }
+        }
+    }
+
+    GET_PAGE_FAULTS(-1, &Z502_REG5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+    printf("Test3u, PID %ld, %d pages, %ld page faults, %ld errors\n",
+            Z502_REG4, TEST3U_PAGES, Z502_REG5, Errors);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3u should be terminated but isn't.\n");
+
+}                                                 // End test3u
+
+/**************************************************************************
+
+ Test3t
+
+ Started by test3o, which sends it a message once it is ready.  Writes
+ TEST3O_PAGES pages, so most of them end up on swap, and reads them
+ back.  Then it tells test3o it is done, and waits for word to go away.
+
+ **************************************************************************/
+
+void test3t(void) {
+    char       msg_buffer[PGSIZE];
+    long       Parent;
+    int        Page;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    RECEIVE_MESSAGE(-1, msg_buffer, PGSIZE, &Z502_REG2, &Parent, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "RECEIVE_MESSAGE");
+
+    for (Page = 0; Page < TEST3O_PAGES; Page++) {
+        Z502_REG3 = PGSIZE * Page;
+        Z502_REG1 = Page + Z502_REG4;
+        MEM_WRITE(Z502_REG3, &Z502_REG1);
+    }
+    for (Page = 0; Page < TEST3O_PAGES; Page++) {
+        Z502_REG3 = PGSIZE * Page;
+        MEM_READ(Z502_REG3, &Z502_REG1);
+        if (Z502_REG1 != Page + Z502_REG4)
+            printf("AN ERROR HAS OCCURRED: page %d of test3t read back %ld\n", Page, Z502_REG1);
+    }
+
+    SEND_MESSAGE(Parent, "full", 5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "SEND_MESSAGE");
+    RECEIVE_MESSAGE(Parent, msg_buffer, PGSIZE, &Z502_REG2, &Z502_REG3, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "RECEIVE_MESSAGE");
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3t should be terminated but isn't.\n");
+
+}                                                 // End test3t
+
+/**************************************************************************
+
+ Test3s
+
+ Started by test3g as a copy of it.  Checks it sees the template test3g
+ wrote, writes its own value to every TEST3S_WRITE_STEP page of it and
+ checks those, then reads the pages test3g never wrote a second time,
+ and reports any page that didn't hold what it should.
+
+ **************************************************************************/
+#define         TEST3S_WRITE_STEP           8
+
+void test3s(void) {
+    long   Errors = 0;
+    int    Page;
+    int    Pass;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3s: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Pass = 0; Pass < 2; Pass++) {
+        for (Page = 0; Page < TEST3G_TEMPLATE; Page++) {
+            Z502_REG3 = PGSIZE * Page;
+            if (Pass == 1 && Page % TEST3S_WRITE_STEP == 0)
+                Z502_REG1 = Z502_REG3 + Z502_REG4 * 1000;
+            else
+                Z502_REG1 = Z502_REG3 + TEST3G_SEED;
+
+            MEM_READ(Z502_REG3, &Z502_REG2);
+            if (Z502_REG2 != Z502_REG1) {
+                printf("AN ERROR HAS OCCURRED: PID %ld page %d pass %d held %ld, expected %ld\n",
+                        Z502_REG4, Page, Pass, Z502_REG2, Z502_REG1);
+                Errors++;
+            }
+
+            // our own copy, for the next pass
+            if (Pass == 0 && Page % TEST3S_WRITE_STEP == 0) {
+                Z502_REG1 = Z502_REG3 + Z502_REG4 * 1000;
+                MEM_WRITE(Z502_REG3, &Z502_REG1);
+            }
+        }
+    }
+
+    for (Page = 0; Page < TEST3G_SPARSE; Page++) {
+        Z502_REG3 = PGSIZE * (TEST3G_SPARSE_START + Page * TEST3G_SPARSE_STEP);
+        MEM_READ(Z502_REG3, &Z502_REG2);
+        if (Z502_REG2 != 0) {
+            printf("AN ERROR HAS OCCURRED: PID %ld untouched page %ld held %ld\n",
+                    Z502_REG4, Z502_REG3 / PGSIZE, Z502_REG2);
+            Errors++;
+        }
+    }
+
+    GET_PAGE_FAULTS(-1, &Z502_REG5, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "GET_PAGE_FAULTS");
+    printf("Test3s, PID %ld, %ld page faults, %ld errors\n", Z502_REG4, Z502_REG5, Errors);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3s should be terminated but isn't.\n");
+
+}                                                 // End test3s
+
+/**************************************************************************
+
+ Test3r
+
+ Started by test3h.  Writes TEST3R_LOOPS sectors of its own, scattered
+ over TEST3H_DISK, and reads each one straight back, timing every transfer.
+ Reports the average and the worst, and any sector that didn't hold
+ what was written to it.
+
+ **************************************************************************/
+
+void test3r(void) {
+    DISK_DATA  data_written;
+    DISK_DATA  data_read;
+    long       sector;
+    long       Sector_id;
+    long       Errors = 0;
+    long       Total = 0;
+    long       Worst = 0;
+    int        Iterations;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3r: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    sector = Z502_REG4;
+    for (Iterations = 0; Iterations < TEST3R_LOOPS; Iterations++) {
+        // every worker has sectors of its own, spread over the whole disk
+        sector = (sector * 177 + 1) % (NUM_LOGICAL_SECTORS / TEST3R_SPREAD);
+        Sector_id = sector * TEST3R_SPREAD + Z502_REG4 % TEST3R_SPREAD;
+        data_written.int_data[0] = TEST3H_DISK;
+        data_written.int_data[1] = Sector_id;
+        data_written.int_data[2] = (int) Z502_REG4;
+        data_written.int_data[3] = Iterations;
+
+        GET_TIME_OF_DAY(&Z502_REG1);
+        DISK_WRITE(TEST3H_DISK, Sector_id, (char* )(data_written.char_data));
+        GET_TIME_OF_DAY(&Z502_REG2);
+        DISK_READ(TEST3H_DISK, Sector_id, (char* )(data_read.char_data));
+        GET_TIME_OF_DAY(&Z502_REG3);
+
+        Total += Z502_REG3 - Z502_REG1;
+        if (Z502_REG2 - Z502_REG1 > Worst)
+            Worst = Z502_REG2 - Z502_REG1;
+        if (Z502_REG3 - Z502_REG2 > Worst)
+            Worst = Z502_REG3 - Z502_REG2;
+
+        if (memcmp(data_read.char_data, data_written.char_data, 4 * sizeof(int)) != 0) {
+            printf("AN ERROR HAS OCCURRED: PID %ld sector %ld didn't hold what was written\n",
+                    Z502_REG4, Sector_id);
+            Errors++;
+        }
+    }
+
+    printf("Test3r, PID %ld, %d transfers, average %ld, worst %ld, %ld errors\n",
+            Z502_REG4, TEST3R_LOOPS * 2, Total / (TEST3R_LOOPS * 2), Worst, Errors);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3r should be terminated but isn't.\n");
+
+}                                                 // End test3r
+
+/**************************************************************************
+
+ Test3q
+
+ Started by test3i.  Writes each of TEST3Q_SECTORS sectors of its own
+ TEST3Q_ROUNDS times, timing every write, and calls FLUSH_DISK once it
+ is done.  Then it reads them all back and reports any sector that
+ doesn't hold the last thing written to it.
+
+ **************************************************************************/
+
+void test3q(void) {
+    DISK_DATA  data_written;
+    DISK_DATA  data_read;
+    long       Errors = 0;
+    long       Worst = 0;
+    long       Total = 0;
+    int        Round;
+    int        Sector;
+
+    GET_PROCESS_ID("", &Z502_REG4, &Z502_REG9);
+    printf("Release %s:Test 3q: Pid %ld\n", CURRENT_REL, Z502_REG4);
+
+    for (Round = 0; Round < TEST3Q_ROUNDS; Round++) {
+        for (Sector = 0; Sector < TEST3Q_SECTORS; Sector++) {
+            Z502_REG5 = Z502_REG4 * TEST3Q_SECTORS + Sector;
+            data_written.int_data[0] = TEST3I_DISK;
+            data_written.int_data[1] = Z502_REG5;
+            data_written.int_data[2] = (int) Z502_REG4;
+            data_written.int_data[3] = Round;
+
+            GET_TIME_OF_DAY(&Z502_REG1);
+            DISK_WRITE(TEST3I_DISK, Z502_REG5, (char* )(data_written.char_data));
+            GET_TIME_OF_DAY(&Z502_REG2);
+
+            Total += Z502_REG2 - Z502_REG1;
+            if (Z502_REG2 - Z502_REG1 > Worst)
+                Worst = Z502_REG2 - Z502_REG1;
+        }
+    }
+
+    FLUSH_DISK(TEST3I_DISK, &Z502_REG9);
+    SuccessExpected(Z502_REG9, "FLUSH_DISK");
+
+    for (Sector = 0; Sector < TEST3Q_SECTORS; Sector++) {
+        Z502_REG5 = Z502_REG4 * TEST3Q_SECTORS + Sector;
+        DISK_READ(TEST3I_DISK, Z502_REG5, (char* )(data_read.char_data));
+        if (data_read.int_data[1] != Z502_REG5 || data_read.int_data[2] != Z502_REG4
+                || data_read.int_data[3] != TEST3Q_ROUNDS - 1) {
+            printf("AN ERROR HAS OCCURRED: PID %ld sector %ld didn't hold the last write to it\n",
+                    Z502_REG4, Z502_REG5);
+            Errors++;
+        }
+    }
+
+    printf("Test3q, PID %ld, %d writes, average %ld, worst %ld, %ld errors\n", Z502_REG4,
+            TEST3Q_SECTORS * TEST3Q_ROUNDS, Total / (TEST3Q_SECTORS * TEST3Q_ROUNDS), Worst, Errors);
+
+    TERMINATE_PROCESS(-1, &Z502_REG9);
+    printf("ERROR: Test3q should be terminated but isn't.\n");
+
+}                                                 // End test3q
+
 /**************************************************************************
 
  get_skewed_random_number   Is a homegrown deterministic random
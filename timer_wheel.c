@@ -0,0 +1,223 @@
+#include "timer_wheel.h"
+
+/**
+* Returns an empty hierarchical timing wheel whose clock starts at start_time
+*/
+TimerWheel create_timer_wheel(INT32 start_time) {
+    TimerWheel w = (TimerWheel) calloc(1, sizeof(TimerWheelData));
+
+    // In case we are out of memory, or something crazy happens...
+    if (w == NULL) {
+        printf("Could not create timer wheel...");
+        return NULL;
+    }
+
+    w->expired = NULL;
+    w->current_time = start_time;
+    w->count = 0;
+    return w;
+}
+
+/**
+* Push a node onto the front of a slot (or the expired list)
+*/
+static void link_node(TimerNode** head, TimerNode* node) {
+    node->prev = NULL;
+    node->next = *head;
+    if (*head != NULL)
+        (*head)->prev = node;
+    *head = node;
+}
+
+/**
+* Places a node on the level whose span covers its deadline.  Anything whose
+* deadline has already arrived goes into the level 0 slot for the current tick.
+*/
+static void place_node(TimerWheel w, TimerNode* node) {
+    INT32 delta = node->deadline - w->current_time;
+    INT32 deadline = node->deadline;
+    int level = 0;
+
+    if (delta < 0) {
+        delta = 0;
+        deadline = w->current_time;
+    }
+
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1 << (TIMER_WHEEL_SLOT_BITS * (level + 1))))
+        level++;
+
+    // Deadlines beyond the span of the top level park in its furthest slot
+    // and get re-filed every time that slot cascades
+    if (delta >= (1 << (TIMER_WHEEL_SLOT_BITS * (level + 1))))
+        deadline = w->current_time + (1 << (TIMER_WHEEL_SLOT_BITS * (level + 1))) - 1;
+
+    node->level = level;
+    node->slot = (deadline >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+    link_node(&w->slots[level][node->slot], node);
+}
+
+/**
+* Adds a process to the wheel using p->delay as its wake up time.
+* This is O(1) no matter how many processes are sleeping.
+*/
+void timer_wheel_insert(TimerWheel w, PCB* p, INT32 current_time) {
+    if (w == NULL || p == NULL)
+        return;
+
+    // Nothing is pending, so there is no reason to walk the wheel up to now later on
+    if (w->count == 0 && current_time > w->current_time)
+        w->current_time = current_time;
+
+    TimerNode* node = (TimerNode*) calloc(1, sizeof(TimerNode));
+    node->data = p;
+    node->deadline = p->delay;
+    p->timer_node = node;
+
+    place_node(w, node);
+    w->count++;
+}
+
+/**
+* Remove a process from the wheel, wherever it is.  Returns NULL if it wasn't sleeping.
+*/
+PCB* timer_wheel_remove(TimerWheel w, PCB* p) {
+    if (w == NULL || p == NULL || p->timer_node == NULL)
+        return NULL;
+
+    TimerNode* node = p->timer_node;
+
+    if (node->prev != NULL)
+        node->prev->next = node->next;
+    else if (node->level < 0)
+        w->expired = node->next;
+    else
+        w->slots[node->level][node->slot] = node->next;
+
+    if (node->next != NULL)
+        node->next->prev = node->prev;
+
+    p->timer_node = NULL;
+    w->count--;
+    free(node);
+    return p;
+}
+
+/**
+* Empties a slot and re-files everything that was in it against the current time
+*/
+static void cascade(TimerWheel w, int level, int slot) {
+    TimerNode* cursor = w->slots[level][slot];
+    w->slots[level][slot] = NULL;
+
+    while (cursor != NULL) {
+        TimerNode* next = cursor->next;
+        place_node(w, cursor);
+        cursor = next;
+    }
+}
+
+/**
+* Walk the wheel forward until every deadline up to and including current_time
+* has been moved over to the expired list
+*/
+static void advance(TimerWheel w, INT32 current_time) {
+    int level;
+
+    while (w->current_time <= current_time) {
+        // nothing left to find, so jump straight to the present
+        if (w->count == 0) {
+            w->current_time = current_time + 1;
+            return;
+        }
+
+        // on a level 0 wrap, pull the next block of each higher level down
+        for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((w->current_time & ((1 << (TIMER_WHEEL_SLOT_BITS * level)) - 1)) != 0)
+                break;
+            cascade(w, level, (w->current_time >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK);
+        }
+
+        int slot = w->current_time & TIMER_WHEEL_SLOT_MASK;
+        TimerNode* cursor = w->slots[0][slot];
+        w->slots[0][slot] = NULL;
+
+        while (cursor != NULL) {
+            TimerNode* next = cursor->next;
+            cursor->level = -1;
+            link_node(&w->expired, cursor);
+            cursor = next;
+        }
+
+        w->current_time++;
+    }
+}
+
+/**
+* Hands back one process whose deadline is at or before current_time,
+* or NULL once every expired process has been returned.
+*/
+PCB* timer_wheel_next_expired(TimerWheel w, INT32 current_time) {
+    if (w == NULL)
+        return NULL;
+
+    advance(w, current_time);
+
+    if (w->expired == NULL)
+        return NULL;
+
+    return timer_wheel_remove(w, w->expired->data);
+}
+
+/**
+* Returns the earliest deadline on the wheel, or -1 if nobody is sleeping
+*/
+INT32 timer_wheel_next_deadline(TimerWheel w) {
+    INT32 earliest = -1;
+    int level;
+    int i;
+
+    if (w == NULL || w->count == 0)
+        return -1;
+
+    // already expired, so the deadline is right now
+    if (w->expired != NULL)
+        return w->current_time;
+
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        int first_slot = (w->current_time >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+
+        // once the block we are in has cascaded on an upper level, anything
+        // still filed under it there is a full revolution away
+        if (level > 0 && (w->current_time & ((1 << (TIMER_WHEEL_SLOT_BITS * level)) - 1)) != 0)
+            first_slot++;
+
+        // only the first occupied slot of a level can hold its earliest deadline
+        for (i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            TimerNode* cursor = w->slots[level][(first_slot + i) & TIMER_WHEEL_SLOT_MASK];
+            if (cursor == NULL)
+                continue;
+
+            while (cursor != NULL) {
+                if (earliest == -1 || cursor->deadline < earliest)
+                    earliest = cursor->deadline;
+                cursor = cursor->next;
+            }
+            break;
+        }
+    }
+
+    if (earliest != -1 && earliest < w->current_time)
+        earliest = w->current_time;
+
+    return earliest;
+}
+
+/**
+* Return the number of processes sleeping on the wheel
+*/
+int timer_wheel_count(TimerWheel w) {
+    if (w == NULL)
+        return 0;
+    return w->count;
+}
@@ -0,0 +1,36 @@
+#ifndef TIMER_WHEEL
+#define TIMER_WHEEL
+#include "my_globals.h"
+
+// Each level of the wheel has 64 slots, so level n covers 64^(n+1) ticks
+#define         TIMER_WHEEL_LEVELS          4
+#define         TIMER_WHEEL_SLOT_BITS       6
+#define         TIMER_WHEEL_SLOTS           (1 << TIMER_WHEEL_SLOT_BITS)
+#define         TIMER_WHEEL_SLOT_MASK       (TIMER_WHEEL_SLOTS - 1)
+
+// A sleeping process hangs off exactly one slot of the wheel
+typedef struct TimerNode {
+    PCB*                data;
+    INT32               deadline;
+    short               level;
+    short               slot;
+    struct TimerNode*   next;
+    struct TimerNode*   prev;
+} TimerNode;
+
+typedef struct {
+    TimerNode*  slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    TimerNode*  expired;        // deadlines that have passed but have not been handed out yet
+    INT32       current_time;   // the next tick to be processed; everything before it has expired
+    int         count;          // number of processes on the wheel (including expired ones)
+} TimerWheelData, *TimerWheel;
+
+// function prototypes
+TimerWheel create_timer_wheel(INT32 start_time);
+void timer_wheel_insert(TimerWheel w, PCB* p, INT32 current_time);
+PCB* timer_wheel_remove(TimerWheel w, PCB* p);
+PCB* timer_wheel_next_expired(TimerWheel w, INT32 current_time);
+INT32 timer_wheel_next_deadline(TimerWheel w);
+int timer_wheel_count(TimerWheel w);
+
+#endif
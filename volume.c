@@ -0,0 +1,86 @@
+#include "volume.h"
+
+/**
+* Returns a volume made of member_count disks from first_disk on.  A
+* RAID-0 volume puts stripe_sectors sectors on each member in turn.
+*/
+Volume create_volume(INT32 volume_id, INT32 type, INT32 first_disk, INT32 member_count, INT32 stripe_sectors) {
+    Volume v = (Volume) calloc(1, sizeof(VolumeData));
+
+    // In case we are out of memory, or something crazy happens...
+    if (v == NULL) {
+        printf("Could not create volume...");
+        return NULL;
+    }
+
+    v->volume_id = volume_id;
+    v->type = type;
+    v->first_disk = first_disk;
+    v->member_count = member_count;
+    v->stripe_sectors = stripe_sectors;
+    return v;
+}
+
+/**
+* Return the number of sectors the volume holds.  Whatever is left over
+* at the end of a RAID-0 member after its last whole stripe goes unused.
+*/
+INT32 volume_sector_count(Volume v) {
+    if (v->type == VOLUME_RAID1)
+        return NUM_LOGICAL_SECTORS;
+    return v->member_count * (NUM_LOGICAL_SECTORS / v->stripe_sectors) * v->stripe_sectors;
+}
+
+/**
+* TRUE if a disk is one of the volume's members
+*/
+BOOL volume_has_member(Volume v, INT32 disk_id) {
+    return v != NULL && disk_id >= v->first_disk && disk_id < v->first_disk + v->member_count;
+}
+
+/**
+* Works out which member, and which of its sectors, a sector of the
+* volume is on.  Every member of a mirror has it; this gives the first.
+*/
+void volume_locate(Volume v, INT32 sector_id, INT32* disk_id, INT32* member_sector) {
+    INT32 stripe;
+
+    if (v->type == VOLUME_RAID1) {
+        *disk_id = v->first_disk;
+        *member_sector = sector_id;
+        return;
+    }
+
+    stripe = sector_id / v->stripe_sectors;
+    *disk_id = v->first_disk + stripe % v->member_count;
+    *member_sector = (stripe / v->member_count) * v->stripe_sectors + sector_id % v->stripe_sectors;
+}
+
+/**
+* Picks the member of a mirror a read of sector_id goes to, going by
+* what each member's queue has on it and where its head is.  The first
+* member wins a tie.
+*/
+INT32 volume_pick_mirror(Volume v, DiskQueue* queues, INT32 sector_id, INT32 policy) {
+    INT32 best = v->first_disk;
+    INT32 best_busy = 0;
+    INT32 best_distance = 0;
+    INT32 busy;
+    INT32 distance;
+    INT32 disk;
+
+    for (disk = v->first_disk; disk < v->first_disk + v->member_count; disk++) {
+        busy = queues[disk]->length + queues[disk]->active_count;
+        distance = abs(queues[disk]->head_sector - sector_id);
+        if (disk == v->first_disk
+                || (policy == MIRROR_LEAST_BUSY
+                    && (busy < best_busy || (busy == best_busy && distance < best_distance)))
+                || (policy == MIRROR_NEAREST_HEAD
+                    && (distance < best_distance || (distance == best_distance && busy < best_busy)))) {
+            best = disk;
+            best_busy = busy;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
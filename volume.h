@@ -0,0 +1,36 @@
+#ifndef VOLUME
+#define VOLUME
+#include "my_globals.h"
+#include "disk.h"
+
+// A volume is a run of disks the OS presents as one more disk, numbered
+// after the real ones.  RAID-0 deals its sectors out across the members
+// a stripe at a time, so a long transfer keeps every member busy.
+// RAID-1 keeps every sector on every member: a write goes to all of
+// them, and a read to just the one the mirror policy picks.
+#define         VOLUME_RAID0            0
+#define         VOLUME_RAID1            1
+
+// How RAID-1 picks the member a read goes to
+#define         MIRROR_LEAST_BUSY       0       // fewest transfers queued or going, nearest head on a tie
+#define         MIRROR_NEAREST_HEAD     1       // head closest to the sector, least busy on a tie
+
+typedef struct {
+    INT32   volume_id;          // the disk number it answers to
+    INT32   type;               // VOLUME_RAID0 or VOLUME_RAID1
+    INT32   first_disk;         // the members are first_disk on, one after the other
+    INT32   member_count;
+    INT32   stripe_sectors;     // RAID-0 sectors on one member before it is the next one's turn
+    long    reads;
+    long    writes;
+    long    member_reads[MAX_NUMBER_OF_DISKS];  // reads each member has taken
+} VolumeData, *Volume;
+
+// function prototypes
+Volume create_volume(INT32 volume_id, INT32 type, INT32 first_disk, INT32 member_count, INT32 stripe_sectors);
+INT32 volume_sector_count(Volume v);
+BOOL volume_has_member(Volume v, INT32 disk_id);
+void volume_locate(Volume v, INT32 sector_id, INT32* disk_id, INT32* member_sector);
+INT32 volume_pick_mirror(Volume v, DiskQueue* queues, INT32 sector_id, INT32 policy);
+
+#endif
@@ -0,0 +1,106 @@
+#include "wait_queue.h"
+
+/**
+* Returns an empty wait queue.  reason is what the processes that wait
+* on it are suspended for.
+*/
+WaitQueue create_wait_queue(INT32 reason) {
+    WaitQueue q = (WaitQueue) calloc(1, sizeof(WaitQueueData));
+
+    // In case we are out of memory, or something crazy happens...
+    if (q == NULL) {
+        printf("Could not create wait queue...");
+        return NULL;
+    }
+
+    q->first = NULL;
+    q->last = NULL;
+    q->reason = reason;
+    return q;
+}
+
+/**
+* Suspends a process on the queue.  It stops running once it gives up
+* the CPU, and stays put until somebody wakes it.
+*/
+void wait_queue_add(WaitQueue q, PCB* p) {
+    // a process only ever waits for one thing
+    if (p->wait_queue != NULL)
+        wait_queue_remove(p->wait_queue, p);
+
+    p->wait_next = NULL;
+    if (q->last == NULL)
+        q->first = p;
+    else
+        q->last->wait_next = p;
+    q->last = p;
+    q->length++;
+
+    p->wait_queue = q;
+    p->state = SUSPEND;
+    p->suspend_reason = q->reason;
+}
+
+/**
+* Takes a process off the queue without waking it.  Returns FALSE if it
+* wasn't on it.
+*/
+BOOL wait_queue_remove(WaitQueue q, PCB* p) {
+    PCB* previous = NULL;
+    PCB* cursor;
+
+    if (q == NULL || p->wait_queue != q)
+        return FALSE;
+
+    for (cursor = q->first; cursor != NULL && cursor != p; cursor = cursor->wait_next)
+        previous = cursor;
+    if (cursor == NULL)
+        return FALSE;
+
+    if (previous == NULL)
+        q->first = p->wait_next;
+    else
+        previous->wait_next = p->wait_next;
+    if (q->last == p)
+        q->last = previous;
+    q->length--;
+
+    p->wait_next = NULL;
+    p->wait_queue = NULL;
+    return TRUE;
+}
+
+/**
+* Wakes one particular process, if it is waiting on the queue.  Returns
+* FALSE if it wasn't, and leaves it alone.
+*/
+BOOL wait_queue_wake(WaitQueue q, PCB* p) {
+    if (!wait_queue_remove(q, p))
+        return FALSE;
+
+    p->state = READY;
+    p->suspend_reason = WAITING_UNDEFINED;
+    return TRUE;
+}
+
+/**
+* Wakes everyone on the queue.  Returns how many there were.
+*/
+INT32 wait_queue_wake_all(WaitQueue q) {
+    INT32 woken = 0;
+
+    while (q->first != NULL) {
+        wait_queue_wake(q, q->first);
+        woken++;
+    }
+    return woken;
+}
+
+/**
+* Return the number of processes waiting on the queue
+*/
+INT32 wait_queue_length(WaitQueue q) {
+    if (q == NULL)
+        return 0;
+    return q->length;
+}
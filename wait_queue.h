@@ -0,0 +1,24 @@
+#ifndef WAIT_QUEUE
+#define WAIT_QUEUE
+#include "my_globals.h"
+
+// Processes blocked until something happens, woken in the order they
+// started waiting.  A process waits on at most one queue at a time, and
+// the links live in its PCB.  Whoever uses a queue guards it with the
+// same lock that guards what the processes on it are waiting for.
+typedef struct WaitQueueData {
+    PCB*        first;
+    PCB*        last;
+    INT32       length;
+    INT32       reason;         // the suspend reason of everyone on it
+} WaitQueueData, *WaitQueue;
+
+// function prototypes
+WaitQueue create_wait_queue(INT32 reason);
+void wait_queue_add(WaitQueue q, PCB* p);
+BOOL wait_queue_remove(WaitQueue q, PCB* p);
+BOOL wait_queue_wake(WaitQueue q, PCB* p);
+INT32 wait_queue_wake_all(WaitQueue q);
+INT32 wait_queue_length(WaitQueue q);
+
+#endif
@@ -113,7 +113,17 @@ void HandleWindowsError();
 void HardwareClock(INT32 *);
 void HardwareTimer(INT32);
 void HardwareReadDisk(INT16, INT16, char *);
-void HardwareWriteDisk(INT16, INT16, char *);
+void HardwareWriteDisk(INT16, INT16, char *, BOOL);
+void HardwareFlushDisk(INT16);
+void HardwareTrimDisk(INT16, INT16, INT32);
+void StartDiskChannel(INT16, INT32);
+void FinishDiskChannel(INT16, INT32);
+void RemoveSectorStruct(INT16, INT16, INT32);
+BOOL TrackCacheHolds(INT16, INT16);
+void FillTrackCache(INT16, INT16);
+BOOL WriteCacheHolds(INT16, INT16);
+INT32 WriteCacheSlot(INT16, INT16);
+INT32 WriteCacheUnsaved(INT16);
 void HardwareInterrupt(void);
 void HardwareFault(INT16, INT16);
 void HardwareInternalPanic(INT32);
@@ -138,7 +148,7 @@ void Z502Init();
 //      This is Physical Memory which is used in part 2 of the project. 
 //  
 
-char MEMORY[PHYS_MEM_PGS * PGSIZE ];
+char MEMORY[MAX_PHYS_MEM_PGS * PGSIZE ];
 
 //
 //      Declaration of Z502 Registers                 
@@ -224,7 +234,7 @@ int NextMutexToAllocate = 0;
 void MemoryCommon(INT32 VirtualAddress, char *data_ptr, BOOL read_or_write) {
     INT16 VirtualPageNumber;
     INT32 phys_pg;
-    INT16 PhysicalAddress[4];
+    INT32 PhysicalAddress[4];
     INT32 page_offset;
     INT16 index;
     INT32 ptbl_bits;
@@ -261,6 +271,10 @@ void MemoryCommon(INT32 VirtualAddress, char *data_ptr, BOOL read_or_write) {
                 && (Z502_PAGE_TBL_ADDR[(UINT16) VirtualPageNumber]
                         & PTBL_VALID_BIT) == 0)
             invalidity = 5;
+        if ((invalidity == 0) && (read_or_write == SYSNUM_MEM_WRITE)
+                && (Z502_PAGE_TBL_ADDR[(UINT16) VirtualPageNumber]
+                        & PTBL_READ_ONLY_BIT) != 0)
+            invalidity = 9;
 
         DoMemoryDebug(invalidity, VirtualPageNumber);
         if (invalidity > 0) {
@@ -280,7 +294,7 @@ void MemoryCommon(INT32 VirtualAddress, char *data_ptr, BOOL read_or_write) {
     } /* END of while         */
 
     phys_pg = Z502_PAGE_TBL_ADDR[VirtualPageNumber] & PTBL_PHYS_PG_NO;
-    PhysicalAddress[0] = (INT16) (phys_pg * (INT32) PGSIZE + page_offset);
+    PhysicalAddress[0] = (INT32) (phys_pg * (INT32) PGSIZE + page_offset);
     PhysicalAddress[1] = PhysicalAddress[0] + 1; /* first guess */
     PhysicalAddress[2] = PhysicalAddress[0] + 2; /* first guess */
     PhysicalAddress[3] = PhysicalAddress[0] + 3; /* first guess */
@@ -297,6 +311,10 @@ void MemoryCommon(INT32 VirtualAddress, char *data_ptr, BOOL read_or_write) {
             if ((Z502_PAGE_TBL_ADDR[(UINT16) VirtualPageNumber + 1]
                     & PTBL_VALID_BIT) == 0)
                 invalidity = 8;
+            if ((invalidity == 0) && (read_or_write == SYSNUM_MEM_WRITE)
+                    && (Z502_PAGE_TBL_ADDR[(UINT16) VirtualPageNumber + 1]
+                            & PTBL_READ_ONLY_BIT) != 0)
+                invalidity = 10;
             DoMemoryDebug(invalidity, (short) (VirtualPageNumber + 1));
             if (invalidity > 0) {
                 if (Z502_CURRENT_CONTEXT->structure_id != CONTEXT_STRUCTURE_ID) {
@@ -313,11 +331,11 @@ void MemoryCommon(INT32 VirtualAddress, char *data_ptr, BOOL read_or_write) {
 
         phys_pg = Z502_PAGE_TBL_ADDR[VirtualPageNumber + 1] & PTBL_PHYS_PG_NO;
         for (index = PGSIZE - (INT16) page_offset; index <= 3; index++)
-            PhysicalAddress[index] = (INT16) ((phys_pg - 1) * (INT32) PGSIZE
+            PhysicalAddress[index] = (INT32) ((phys_pg - 1) * (INT32) PGSIZE
                     + page_offset + (INT32) index);
     } /* End of if page       */
 
-    if (phys_pg < 0 || phys_pg > PHYS_MEM_PGS - 1) {
+    if (phys_pg < 0 || phys_pg > MAX_PHYS_MEM_PGS - 1) {
         printf("The physical address is invalid in MemoryCommon\n");
         printf("Physical page = %d, Virtual Page = %d\n", phys_pg,
                 VirtualPageNumber);
@@ -417,6 +435,13 @@ void DoMemoryDebug(INT16 invalidity, INT16 vpn) {
         printf("\t\tYou must aim this virtual page at a physical frame\n");
         printf("\t\tand mark this page table slot as valid.\n");
     }
+    if (invalidity == 9) {
+        printf("You wrote to virtual page %d, which is marked read only.\n", vpn);
+    }
+    if (invalidity == 10) {
+        printf("The address you asked for crosses onto a second page.\n");
+        printf("\t\tYou wrote to it, and virtual page %d is marked read only.\n", vpn);
+    }
 }                        // End of DoMemoryDebug         
 
 /*****************************************************************
@@ -573,6 +598,8 @@ void MemoryMappedIO(INT32 address, INT32 *data, BOOL read_or_write) {
                 MemoryMappedDiskState.sector = -1;
                 MemoryMappedDiskState.action = -1;
                 MemoryMappedDiskState.buffer = (char *) -1;
+                MemoryMappedDiskState.tag = -1;
+                MemoryMappedDiskState.count = 1;
             } else {
                 if (DO_DEVICE_DEBUG) {
                     printf( "------ BEGIN DO_DEVICE DEBUG - IN Z502DiskSetID ---------------- \n");
@@ -638,16 +665,28 @@ void MemoryMappedIO(INT32 address, INT32 *data, BOOL read_or_write) {
         case Z502DiskStart: {
             if (*data == 0 && MemoryMappedIODiskDevice != -1
                     && MemoryMappedDiskState.action != -1
-                    && MemoryMappedDiskState.buffer != (char *) -1
-                    && MemoryMappedDiskState.sector != -1) {
-                if (MemoryMappedDiskState.action == 0)
+                    && (MemoryMappedDiskState.buffer != (char *) -1
+                            || MemoryMappedDiskState.action == DISK_ACTION_TRIM
+                            || MemoryMappedDiskState.action == DISK_ACTION_FLUSH)
+                    && (MemoryMappedDiskState.sector != -1
+                            || MemoryMappedDiskState.action == DISK_ACTION_FLUSH)) {
+                disk_state[MemoryMappedIODiskDevice].next_tag = MemoryMappedDiskState.tag;
+                if (MemoryMappedDiskState.action == DISK_ACTION_READ)
                     HardwareReadDisk((INT16) MemoryMappedIODiskDevice,
                             MemoryMappedDiskState.sector,
                             MemoryMappedDiskState.buffer);
-                if (MemoryMappedDiskState.action == 1)
+                if (MemoryMappedDiskState.action == DISK_ACTION_WRITE
+                        || MemoryMappedDiskState.action == DISK_ACTION_WRITE_FUA)
                     HardwareWriteDisk((INT16) MemoryMappedIODiskDevice,
                             MemoryMappedDiskState.sector,
-                            MemoryMappedDiskState.buffer);
+                            MemoryMappedDiskState.buffer,
+                            MemoryMappedDiskState.action == DISK_ACTION_WRITE_FUA);
+                if (MemoryMappedDiskState.action == DISK_ACTION_FLUSH)
+                    HardwareFlushDisk((INT16) MemoryMappedIODiskDevice);
+                if (MemoryMappedDiskState.action == DISK_ACTION_TRIM)
+                    HardwareTrimDisk((INT16) MemoryMappedIODiskDevice,
+                            MemoryMappedDiskState.sector,
+                            MemoryMappedDiskState.count);
             } else {
                 if (DO_DEVICE_DEBUG) {
                     printf(
@@ -677,6 +716,84 @@ void MemoryMappedIO(INT32 address, INT32 *data, BOOL read_or_write) {
                     *data = DEVICE_FREE;
             }
             break;
+        }
+            /*  A disk can only be made solid state, or spinning again,
+             *  while it has nothing going.  */
+        case Z502DiskSetType: {
+            if (MemoryMappedIODiskDevice == -1)
+                *data = ERR_BAD_DEVICE_ID;
+            else if (read_or_write == SYSNUM_MEM_READ)
+                *data = disk_state[MemoryMappedIODiskDevice].type;
+            else if ((*data == DISK_TYPE_SPINNING || *data == DISK_TYPE_SSD)
+                    && disk_state[MemoryMappedIODiskDevice].channels_in_use == 0)
+                disk_state[MemoryMappedIODiskDevice].type = (INT16) *data;
+            else {
+                if (DO_DEVICE_DEBUG) {
+                    printf(
+                            "------ BEGIN DO_DEVICE DEBUG - IN Z502DiskSetType ------------- \n");
+                    printf(
+                            "ERROR:  Either that isn't a disk type, or the disk is busy\n");
+                    printf(
+                            "-------- END DO_DEVICE DEBUG - ----------------------------------\n");
+                }
+            }
+            break;
+        }
+            /*  Changing the track cache empties it.  */
+        case Z502DiskSetCacheSize: {
+            if (MemoryMappedIODiskDevice == -1)
+                *data = ERR_BAD_DEVICE_ID;
+            else if (read_or_write == SYSNUM_MEM_READ)
+                *data = disk_state[MemoryMappedIODiskDevice].cache_size;
+            else if (*data >= 0 && *data <= NUM_LOGICAL_SECTORS) {
+                disk_state[MemoryMappedIODiskDevice].cache_size = *data;
+                disk_state[MemoryMappedIODiskDevice].cache_count = 0;
+            }
+            break;
+        }
+            /*  So does changing the write cache, writes and all.  */
+        case Z502DiskSetWriteCache: {
+            if (MemoryMappedIODiskDevice == -1)
+                *data = ERR_BAD_DEVICE_ID;
+            else if (read_or_write == SYSNUM_MEM_READ)
+                *data = disk_state[MemoryMappedIODiskDevice].write_cache_size;
+            else if (*data >= 0 && *data <= WRITE_CACHE_MAX) {
+                disk_state[MemoryMappedIODiskDevice].write_cache_size = *data;
+                for (index = 0; index < WRITE_CACHE_MAX; index++)
+                    disk_state[MemoryMappedIODiskDevice].write_cache_clean_at[index] = 0;
+            }
+            break;
+        }
+        case Z502DiskSetCachePolicy: {
+            if (MemoryMappedIODiskDevice == -1)
+                *data = ERR_BAD_DEVICE_ID;
+            else if (read_or_write == SYSNUM_MEM_READ)
+                *data = disk_state[MemoryMappedIODiskDevice].cache_policy;
+            else if (*data == DISK_CACHE_AHEAD || *data == DISK_CACHE_TRACK) {
+                disk_state[MemoryMappedIODiskDevice].cache_policy = (INT16) *data;
+                disk_state[MemoryMappedIODiskDevice].cache_count = 0;
+            }
+            break;
+        }
+            /*  The OS names each transfer, so it can tell which one a
+             *  disk interrupt is about when several are going at once. */
+        case Z502DiskSetTag: {
+            if (MemoryMappedIODiskDevice != -1)
+                MemoryMappedDiskState.tag = *data;
+            break;
+        }
+            /*  How many sectors a TRIM covers.  */
+        case Z502DiskSetCount: {
+            if (MemoryMappedIODiskDevice != -1)
+                MemoryMappedDiskState.count = *data;
+            break;
+        }
+        case Z502DiskCompletedTag: {
+            if (MemoryMappedIODiskDevice == -1)
+                *data = -1;
+            else
+                *data = disk_state[MemoryMappedIODiskDevice].completed_tag;
+            break;
         }
         default:
             break;
@@ -701,7 +818,7 @@ void MemoryMappedIO(INT32 address, INT32 *data, BOOL read_or_write) {
 
 void PhysicalMemoryCommon(INT32 PhysicalPageNumber, char *data_ptr,
         BOOL read_or_write) {
-    INT16 PhysicalPageAddress;
+    INT32 PhysicalPageAddress;
     INT16 index;
     char Debug_Text[32];
 
@@ -715,7 +832,7 @@ void PhysicalMemoryCommon(INT32 PhysicalPageNumber, char *data_ptr,
     }
     // If the user has asked for an illegal physical page, take a fault
     // then return with no modification to the user's buffer.
-    if (PhysicalPageNumber < 0 || PhysicalPageNumber > PHYS_MEM_PGS) {
+    if (PhysicalPageNumber < 0 || PhysicalPageNumber >= MAX_PHYS_MEM_PGS) {
         ReleaseLock(HardwareLock, Debug_Text);
         HardwareFault(INVALID_PHYSICAL_MEMORY, PhysicalPageNumber);
         return;
@@ -769,9 +886,14 @@ void Z502WritePhysicalMemory(INT32 PhysicalPageNumber,
  o If an event for this disk already exists ( the disk
  is already busy ), then give interrupt error ERR_DISK_IN_USE.
  o Search for sector structure off of hashed value.
- o If search fails give interrupt error = ERR_NO_PREVIOUS_WRITE
+ o If search fails give interrupt error = ERR_NO_PREVIOUS_WRITE.  A solid
+ state disk knows which of its sectors hold nothing, and reads them
+ back as zeros instead.
  o Copy data from sector to buffer.
  o From disk_state information, determine how long this request will take.
+ A sector in the write cache or the track cache comes straight from
+ there; any other waits for the platter to be done with what it has
+ been given, and fills the track cache with its neighbors.
  o Request a future interrupt for this event.
  o Advance time and see if an interrupt has occurred.
 
@@ -781,6 +903,7 @@ void HardwareReadDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
     INT32 local_error;
     char *sector_ptr = 0;
     INT32 access_time;
+    INT32 service_time;
     INT16 error_found;
 
     error_found = 0;
@@ -799,7 +922,7 @@ void HardwareReadDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
 
     if (error_found == 0) {
         GetSectorStructure(disk_id, sector, &sector_ptr, &local_error);
-        if (local_error != 0)
+        if (local_error != 0 && disk_state[disk_id].type != DISK_TYPE_SSD)
             error_found = ERR_NO_PREVIOUS_WRITE;
 
         if (disk_state[disk_id].disk_in_use == TRUE)
@@ -819,29 +942,52 @@ void HardwareReadDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
             printf("      you about that error.\n");
             printf("--- END DO_DEVICE DEBUG - ---------------------\n");
         }
+        // hold the channel before the interrupt can be taken for it
+        if (error_found != ERR_DISK_IN_USE)
+            StartDiskChannel(disk_id, CurrentSimulationTime);
         AddEventToInterruptQueue(CurrentSimulationTime,
                 (INT16) (DISK_INTERRUPT + disk_id - 1), error_found,
                 &disk_state[disk_id].event_ptr);
     } else {
-        memcpy(buffer_ptr, sector_ptr, PGSIZE);
+        if (local_error != 0)
+            memset(buffer_ptr, 0, PGSIZE);
+        else
+            memcpy(buffer_ptr, sector_ptr, PGSIZE);
 
-        access_time = CurrentSimulationTime + 100
-                + abs(disk_state[disk_id].last_sector - sector) / 20;
+        if (disk_state[disk_id].type == DISK_TYPE_SSD) {
+            service_time = SSD_READ_TIME;
+            access_time = CurrentSimulationTime + service_time;
+        }
+        else if (WriteCacheHolds(disk_id, sector)
+                || TrackCacheHolds(disk_id, sector)) {
+            service_time = TRACK_CACHE_HIT_TIME;
+            access_time = CurrentSimulationTime + service_time;
+            HardwareStats.disk_cache_hits[disk_id]++;
+        }
+        else {
+            service_time = 100 + abs(disk_state[disk_id].last_sector - sector) / 20;
+            access_time = LATER_OF((INT32) CurrentSimulationTime,
+                    disk_state[disk_id].media_free_at) + service_time;
+            disk_state[disk_id].media_free_at = access_time;
+            FillTrackCache(disk_id, sector);
+
+            // only a read off the platter moves the head
+            disk_state[disk_id].last_sector = sector;
+        }
         HardwareStats.disk_reads[disk_id]++;
-        HardwareStats.time_disk_busy[disk_id] += access_time
-                - CurrentSimulationTime;
+        // waiting for the platter to finish what it was given is counted there
+        HardwareStats.time_disk_busy[disk_id] += service_time;
         if (DO_DEVICE_DEBUG) {
             printf("--- BEGIN DO_DEVICE DEBUG - IN read_disk ----- \n");
             printf("Time now = %d: ", CurrentSimulationTime);
             printf("  Disk will interrupt at time = %d\n", access_time);
             printf("---- END DO_DEVICE DEBUG - --------------------\n");
         }
+        StartDiskChannel(disk_id, access_time);
         AddEventToInterruptQueue(access_time,
                 (INT16) (DISK_INTERRUPT + disk_id - 1), (INT16) ERR_SUCCESS,
                 &disk_state[disk_id].event_ptr);
-        disk_state[disk_id].last_sector = sector;
     }
-    disk_state[disk_id].disk_in_use = TRUE;
     // printf("1. Setting %d TRUE\n", disk_id );
     ChargeTimeAndCheckEvents(COST_OF_DISK_ACCESS);
 
@@ -861,15 +1007,19 @@ void HardwareReadDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
  o If search fails give create a sector on the simulated disk.
  o Copy data from buffer to sector.
  o From disk_state information, determine how long this request will take.
+ With a write cache, unless fua is set, it is done once there is a place
+ for it in there, and the platter writes it whenever it gets to it.
  o Request a future interrupt for this event.
  o Advance time and see if an interrupt has occurred.
 
  *****************************************************************/
 
-void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
+void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr, BOOL fua) {
     INT32 local_error;
     char *sector_ptr;
     INT32 access_time;
+    INT32 media_time;
+    INT32 slot;
     INT16 error_found;
 
     error_found = 0;
@@ -899,6 +1049,9 @@ void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
             printf("     you about that error.\n");
             printf("---- END DO_DEVICE DEBUG - --------------------\n");
         }
+        // hold the channel before the interrupt can be taken for it
+        if (error_found != ERR_DISK_IN_USE)
+            StartDiskChannel(disk_id, CurrentSimulationTime);
         AddEventToInterruptQueue(CurrentSimulationTime,
                 (INT16) (DISK_INTERRUPT + disk_id - 1), error_found,
                 &disk_state[disk_id].event_ptr);
@@ -911,11 +1064,35 @@ void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
 
         memcpy(sector_ptr, buffer_ptr, PGSIZE);
 
-        access_time = (INT32) CurrentSimulationTime + 100
-                + abs(disk_state[disk_id].last_sector - sector) / 20;
+        if (disk_state[disk_id].type == DISK_TYPE_SSD) {
+            access_time = (INT32) CurrentSimulationTime + SSD_WRITE_TIME;
+            media_time = SSD_WRITE_TIME;
+        }
+        else {
+            media_time = 100 + abs(disk_state[disk_id].last_sector - sector) / 20;
+            if (fua || disk_state[disk_id].write_cache_size == 0) {
+                access_time = LATER_OF((INT32) CurrentSimulationTime,
+                        disk_state[disk_id].media_free_at) + media_time;
+                disk_state[disk_id].media_free_at = access_time;
+            }
+            else {
+                // wait for a place in the write cache, if it is full
+                slot = WriteCacheSlot(disk_id, sector);
+                access_time = LATER_OF((INT32) CurrentSimulationTime,
+                        disk_state[disk_id].write_cache_clean_at[slot])
+                        + WRITE_CACHE_ACK_TIME;
+                disk_state[disk_id].media_free_at = LATER_OF(access_time,
+                        disk_state[disk_id].media_free_at) + media_time;
+                disk_state[disk_id].write_cache_sector[slot] = sector;
+                disk_state[disk_id].write_cache_clean_at[slot] =
+                        disk_state[disk_id].media_free_at;
+                HardwareStats.disk_cached_writes[disk_id]++;
+            }
+            if (fua)
+                HardwareStats.disk_fua_writes[disk_id]++;
+        }
         HardwareStats.disk_writes[disk_id]++;
-        HardwareStats.time_disk_busy[disk_id] += access_time
-                - CurrentSimulationTime;
+        HardwareStats.time_disk_busy[disk_id] += media_time;
         if (DO_DEVICE_DEBUG) {
             printf("--- BEGIN DO_DEVICE DEBUG - IN write_disk ---- \n");
             printf("Time now = %d:  ", CurrentSimulationTime);
@@ -923,17 +1100,345 @@ void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
                     access_time);
             printf("----- END DO_DEVICE DEBUG - -------------------\n");
         }
+        StartDiskChannel(disk_id, access_time);
         AddEventToInterruptQueue(access_time,
                 (INT16) (DISK_INTERRUPT + disk_id - 1), (INT16) ERR_SUCCESS,
                 &disk_state[disk_id].event_ptr);
         disk_state[disk_id].last_sector = sector;
     }
-    disk_state[disk_id].disk_in_use = TRUE;
     // printf("2. Setting %d TRUE\n", disk_id );
     ChargeTimeAndCheckEvents(COST_OF_DISK_ACCESS);
 
 }                           // End of HardwareWriteDisk   
 
+/*****************************************************************
+
+ HardwareFlushDisk
+
+ This code simulates a disk's cache flush.  It finishes once the
+ platter has written everything in the write cache, which is once it
+ is done with all it has been given.  Actions include:
+ o If not in KERNEL_MODE, then cause priv inst trap.
+ o Do range check on disk_id; give interrupt error ERR_BAD_PARAM if
+ illegal.
+ o If every channel of the disk is busy, give interrupt error
+ ERR_DISK_IN_USE.
+ o Request a future interrupt for this event.
+ o Advance time and see if an interrupt has occurred.
+
+ *****************************************************************/
+
+void HardwareFlushDisk(INT16 disk_id) {
+    INT32 access_time;
+    INT16 error_found;
+
+    error_found = 0;
+    // We need to be in kernel mode or be in interrupt handler
+    if (Z502_MODE != KERNEL_MODE && InterruptTid != GetMyTid()) {
+        HardwareFault(PRIVILEGED_INSTRUCTION, 0);
+        return;
+    }
+
+    if (disk_id < 1 || disk_id > MAX_NUMBER_OF_DISKS) {
+        disk_id = 1; /* To aim at legal vector  */
+        error_found = ERR_BAD_PARAM;
+    }
+
+    if (disk_state[disk_id].disk_in_use == TRUE)
+        error_found = ERR_DISK_IN_USE;
+
+    if (error_found != 0) {
+        if (DO_DEVICE_DEBUG) {
+            printf("---- BEGIN DO_DEVICE DEBUG - IN flush_disk --- \n");
+            printf("ERROR:  in your disk request.  The error\n");
+            printf("     code is %d that you can look up in global.h\n",
+                    error_found);
+            printf("    The disk will cause an interrupt to tell \n");
+            printf("     you about that error.\n");
+            printf("---- END DO_DEVICE DEBUG - --------------------\n");
+        }
+        // hold the channel before the interrupt can be taken for it
+        if (error_found != ERR_DISK_IN_USE)
+            StartDiskChannel(disk_id, CurrentSimulationTime);
+        AddEventToInterruptQueue(CurrentSimulationTime,
+                (INT16) (DISK_INTERRUPT + disk_id - 1), error_found,
+                &disk_state[disk_id].event_ptr);
+    } else {
+        access_time = LATER_OF((INT32) CurrentSimulationTime,
+                disk_state[disk_id].media_free_at) + WRITE_CACHE_ACK_TIME;
+        HardwareStats.disk_flushes[disk_id]++;
+        StartDiskChannel(disk_id, access_time);
+        AddEventToInterruptQueue(access_time,
+                (INT16) (DISK_INTERRUPT + disk_id - 1), (INT16) ERR_SUCCESS,
+                &disk_state[disk_id].event_ptr);
+    }
+    ChargeTimeAndCheckEvents(COST_OF_DISK_ACCESS);
+
+}                           // End of HardwareFlushDisk
+
+/*****************************************************************
+
+ HardwareTrimDisk
+
+ This code simulates the TRIM command of a solid state disk, which
+ tells it a run of count sectors no longer holds anything worth
+ keeping.  Actions include:
+ o If not in KERNEL_MODE, then cause priv inst trap.
+ o Do range check on disk_id, sector, count; give interrupt error
+ = ERR_BAD_PARAM if illegal, or if the disk is spinning.
+ o If every channel of the disk is busy, give interrupt error
+ ERR_DISK_IN_USE.
+ o Drop the sectors from the disk.  Reading one gives back
+ zeros until it is written again.  However many
+ there are, it takes the one SSD_TRIM_TIME.
+ o Request a future interrupt for this event.
+ o Advance time and see if an interrupt has occurred.
+
+ *****************************************************************/
+
+void HardwareTrimDisk(INT16 disk_id, INT16 sector, INT32 count) {
+    INT32 access_time;
+    INT16 error_found;
+
+    error_found = 0;
+    // We need to be in kernel mode or be in interrupt handler
+    if (Z502_MODE != KERNEL_MODE && InterruptTid != GetMyTid()) {
+        HardwareFault(PRIVILEGED_INSTRUCTION, 0);
+        return;
+    }
+
+    if (disk_id < 1 || disk_id > MAX_NUMBER_OF_DISKS) {
+        disk_id = 1; /* To aim at legal vector  */
+        error_found = ERR_BAD_PARAM;
+    }
+    if (sector < 0 || sector >= NUM_LOGICAL_SECTORS)
+        error_found = ERR_BAD_PARAM;
+    if (count < 1 || count > NUM_LOGICAL_SECTORS - sector)
+        error_found = ERR_BAD_PARAM;
+    if (disk_state[disk_id].type != DISK_TYPE_SSD)
+        error_found = ERR_BAD_PARAM;
+
+    if (disk_state[disk_id].disk_in_use == TRUE)
+        error_found = ERR_DISK_IN_USE;
+
+    if (error_found != 0) {
+        if (DO_DEVICE_DEBUG) {
+            printf("---- BEGIN DO_DEVICE DEBUG - IN trim_disk ---- \n");
+            printf("ERROR:  in your disk request.  The error\n");
+            printf("     code is %d that you can look up in global.h\n",
+                    error_found);
+            printf("    The disk will cause an interrupt to tell \n");
+            printf("     you about that error.\n");
+            printf("---- END DO_DEVICE DEBUG - --------------------\n");
+        }
+        // hold the channel before the interrupt can be taken for it
+        if (error_found != ERR_DISK_IN_USE)
+            StartDiskChannel(disk_id, CurrentSimulationTime);
+        AddEventToInterruptQueue(CurrentSimulationTime,
+                (INT16) (DISK_INTERRUPT + disk_id - 1), error_found,
+                &disk_state[disk_id].event_ptr);
+    } else {
+        RemoveSectorStruct(disk_id, sector, count);
+
+        access_time = (INT32) CurrentSimulationTime + SSD_TRIM_TIME;
+        HardwareStats.disk_trims[disk_id] += count;
+        HardwareStats.time_disk_busy[disk_id] += access_time
+                - CurrentSimulationTime;
+        StartDiskChannel(disk_id, access_time);
+        AddEventToInterruptQueue(access_time,
+                (INT16) (DISK_INTERRUPT + disk_id - 1), (INT16) ERR_SUCCESS,
+                &disk_state[disk_id].event_ptr);
+    }
+    ChargeTimeAndCheckEvents(COST_OF_DISK_ACCESS);
+
+}                           // End of HardwareTrimDisk
+
+/*****************************************************************
+
+ TrackCacheHolds()
+
+ TRUE if a spinning disk's track cache has a sector in it.
+
+ *****************************************************************/
+
+BOOL TrackCacheHolds(INT16 disk_id, INT16 sector) {
+    return disk_state[disk_id].cache_count > 0
+            && sector >= disk_state[disk_id].cache_first
+            && sector < disk_state[disk_id].cache_first
+                    + disk_state[disk_id].cache_count;
+}                           // End of TrackCacheHolds
+
+/*****************************************************************
+
+ FillTrackCache()
+
+ A spinning disk has just read a sector off the platter, and keeps
+ reading while it is there.  Its track cache gets the cache_size
+ sectors from that one on (DISK_CACHE_AHEAD), or all of the track of
+ cache_size sectors it is on (DISK_CACHE_TRACK), in place of whatever
+ was there before.  Since the cache only says where the sectors are,
+ a later write to one of them is seen by a read that hits.
+
+ *****************************************************************/
+
+void FillTrackCache(INT16 disk_id, INT16 sector) {
+    INT32 size = disk_state[disk_id].cache_size;
+
+    if (size == 0)
+        return;
+    if (disk_state[disk_id].cache_policy == DISK_CACHE_TRACK)
+        disk_state[disk_id].cache_first = sector - sector % size;
+    else
+        disk_state[disk_id].cache_first = sector;
+    disk_state[disk_id].cache_count = size;
+    if (disk_state[disk_id].cache_first + size > NUM_LOGICAL_SECTORS)
+        disk_state[disk_id].cache_count = NUM_LOGICAL_SECTORS
+                - disk_state[disk_id].cache_first;
+}                           // End of FillTrackCache
+
+/*****************************************************************
+
+ WriteCacheHolds()
+
+ TRUE if a write to a sector is in a spinning disk's write cache, and
+ isn't on the platter yet.
+
+ *****************************************************************/
+
+BOOL WriteCacheHolds(INT16 disk_id, INT16 sector) {
+    INT32 slot;
+
+    for (slot = 0; slot < disk_state[disk_id].write_cache_size; slot++) {
+        if (disk_state[disk_id].write_cache_sector[slot] == sector
+                && disk_state[disk_id].write_cache_clean_at[slot]
+                        > (INT32) CurrentSimulationTime)
+            return TRUE;
+    }
+    return FALSE;
+}                           // End of WriteCacheHolds
+
+/*****************************************************************
+
+ WriteCacheSlot()
+
+ Picks the place in a spinning disk's write cache a write to a sector
+ goes.  That is where an earlier write to it still waits, or else one
+ whose write is on the platter already.  If none is, it is the one
+ whose write gets there first, and the new write has to wait for it.
+
+ *****************************************************************/
+
+INT32 WriteCacheSlot(INT16 disk_id, INT16 sector) {
+    INT32 slot;
+    INT32 earliest = 0;
+
+    for (slot = 0; slot < disk_state[disk_id].write_cache_size; slot++) {
+        if (disk_state[disk_id].write_cache_sector[slot] == sector
+                && disk_state[disk_id].write_cache_clean_at[slot]
+                        > (INT32) CurrentSimulationTime)
+            return slot;
+    }
+    for (slot = 0; slot < disk_state[disk_id].write_cache_size; slot++) {
+        if (disk_state[disk_id].write_cache_clean_at[slot]
+                < disk_state[disk_id].write_cache_clean_at[earliest])
+            earliest = slot;
+    }
+    return earliest;
+}                           // End of WriteCacheSlot
+
+/*****************************************************************
+
+ WriteCacheUnsaved()
+
+ The number of writes in a spinning disk's write cache that aren't on
+ the platter yet, and would be lost if the power went now.
+
+ *****************************************************************/
+
+INT32 WriteCacheUnsaved(INT16 disk_id) {
+    INT32 slot;
+    INT32 unsaved = 0;
+
+    for (slot = 0; slot < disk_state[disk_id].write_cache_size; slot++) {
+        if (disk_state[disk_id].write_cache_clean_at[slot]
+                > (INT32) CurrentSimulationTime)
+            unsaved++;
+    }
+    return unsaved;
+}                           // End of WriteCacheUnsaved
+
+/*****************************************************************
+
+ StartDiskChannel()
+
+ A transfer that will be done at done_at takes one of the disk's
+ channels, along with the tag the OS gave it.  A spinning disk has
+ the one channel, a solid state disk has SSD_CHANNELS of them.
+ The disk is in use once they are all taken.
+
+ *****************************************************************/
+
+void StartDiskChannel(INT16 disk_id, INT32 done_at) {
+    static INT32 started = 0;
+    INT32 channels;
+    INT32 channel;
+
+    channels = (disk_state[disk_id].type == DISK_TYPE_SSD) ? SSD_CHANNELS : 1;
+    for (channel = 0; channel < channels; channel++) {
+        if (disk_state[disk_id].channel_done_at[channel] == -1)
+            break;
+    }
+    if (channel == channels) {
+        printf("StartDiskChannel found no free channel on disk %d\n", disk_id);
+        HardwareInternalPanic(ERR_Z502_INTERNAL_BUG);
+    }
+
+    disk_state[disk_id].channel_done_at[channel] = done_at;
+    disk_state[disk_id].channel_started[channel] = started++;
+    disk_state[disk_id].channel_tag[channel] = disk_state[disk_id].next_tag;
+    disk_state[disk_id].next_tag = -1;
+    disk_state[disk_id].channels_in_use++;
+    disk_state[disk_id].disk_in_use = (disk_state[disk_id].channels_in_use >= channels);
+}                           // End of StartDiskChannel
+
+/*****************************************************************
+
+ FinishDiskChannel()
+
+ An interrupt from a disk, scheduled for time_of_event, frees the
+ channel that was due to finish first, and the OS can read its tag
+ from Z502DiskCompletedTag.  Channels due at the same time finish in
+ the order they were started, the same order their events are in.
+ An interrupt for a transfer that was turned away because the disk
+ was busy doesn't free anything, and has no tag.
+
+ *****************************************************************/
+
+void FinishDiskChannel(INT16 disk_id, INT32 time_of_event) {
+    INT32 channel;
+    INT32 first = -1;
+
+    for (channel = 0; channel < SSD_CHANNELS; channel++) {
+        if (disk_state[disk_id].channel_done_at[channel] == -1
+                || disk_state[disk_id].channel_done_at[channel] > time_of_event)
+            continue;
+        if (first == -1
+                || disk_state[disk_id].channel_done_at[channel] < disk_state[disk_id].channel_done_at[first]
+                || (disk_state[disk_id].channel_done_at[channel] == disk_state[disk_id].channel_done_at[first]
+                        && disk_state[disk_id].channel_started[channel] < disk_state[disk_id].channel_started[first]))
+            first = channel;
+    }
+
+    disk_state[disk_id].completed_tag = -1;
+    if (first != -1) {
+        disk_state[disk_id].completed_tag = disk_state[disk_id].channel_tag[first];
+        disk_state[disk_id].channel_done_at[first] = -1;
+        disk_state[disk_id].channels_in_use--;
+    }
+    disk_state[disk_id].disk_in_use = (disk_state[disk_id].channels_in_use
+            >= ((disk_state[disk_id].type == DISK_TYPE_SSD) ? SSD_CHANNELS : 1));
+}                           // End of FinishDiskChannel
+
 /*****************************************************************
 
  HardwareTimer()
@@ -1175,6 +1680,49 @@ void Z502MakeContext(void **ReturningContextPointer, void *starting_address,
 
 }                    // End of Z502MakeContext 
 
+/*****************************************************************
+
+ Z502SetPageTable()
+
+ This is the routine that gives a context its own page table.
+ Actions include:
+ o If not in KERNEL_MODE, then cause priv inst trap.
+ o Validate structure_id on context.  If bogus, return
+ fault error = ERR_ILLEGAL_ADDRESS.
+ o Store the table in the context.  Z502SwitchContext loads it
+ into the hardware whenever this context is run.
+
+ *****************************************************************/
+
+void Z502SetPageTable(void **ContextPointer, UINT16 *page_table,
+        INT16 page_table_len) {
+    Z502CONTEXT *context = (Z502CONTEXT *) *ContextPointer;
+
+    GetLock(HardwareLock, "Z502SetPageTable");
+    // We need to be in kernel mode or be in interrupt handler
+    if (Z502_MODE != KERNEL_MODE && InterruptTid != GetMyTid()) {
+        HardwareFault(PRIVILEGED_INSTRUCTION, 0);
+        return;
+    }
+
+    if (context == NULL || context->structure_id != CONTEXT_STRUCTURE_ID) {
+        ReleaseLock(HardwareLock, "Z502SetPageTable");
+        HardwareFault(CPU_ERROR, (INT16) ERR_ILLEGAL_ADDRESS);
+        return;
+    }
+
+    context->page_table_ptr = page_table;
+    context->page_table_len = page_table_len;
+
+    // The running context's table is already loaded in the hardware
+    if (context == Z502_CURRENT_CONTEXT) {
+        Z502_PAGE_TBL_ADDR = page_table;
+        Z502_PAGE_TBL_LENGTH = page_table_len;
+    }
+    ReleaseLock(HardwareLock, "Z502SetPageTable");
+
+}                    // End of Z502SetPageTable
+
 /*****************************************************************
 
  Z502DestroyContext()
@@ -1191,6 +1739,7 @@ void Z502MakeContext(void **ReturningContextPointer, void *starting_address,
 
 void Z502DestroyContext(void **IncomingContextPointer) {
     Z502CONTEXT **context_ptr = (Z502CONTEXT **) IncomingContextPointer;
+    int i;
 
     GetLock(HardwareLock, "Z502DestroyContext");
     // We need to be in kernel mode or be in interrupt handler
@@ -1208,6 +1757,15 @@ void Z502DestroyContext(void **IncomingContextPointer) {
     if ((*context_ptr)->structure_id != CONTEXT_STRUCTURE_ID)
         HardwareFault(CPU_ERROR, (INT16) ERR_ILLEGAL_ADDRESS);
 
+    // The thread that ran this context will never run again.  Detach it so
+    // a new context that happens to land at the same address can't wake it.
+    GetLock(ThreadTableLock, "Z502DestroyContext");
+    for (i = 0; i < MAX_NUMBER_OF_USER_THREADS; i++) {
+        if (ThreadTable[i].Context == *context_ptr)
+            ThreadTable[i].Context = NULL;
+    }
+    ReleaseLock(ThreadTableLock, "Z502DestroyContext");
+
     (*context_ptr)->structure_id = 0;
     free(*context_ptr);
     ReleaseLock(HardwareLock, "Z502DestroyContext");
@@ -1399,7 +1957,6 @@ void ChargeTimeAndCheckEvents(INT32 time_to_charge) {
 
 void HardwareInterrupt(void) {
     INT32 time_of_event;
-    INT32 index;
     INT16 event_type;
     INT16 event_error;
     INT32 local_error;
@@ -1439,29 +1996,18 @@ void HardwareInterrupt(void) {
                 && event_type <= DISK_INTERRUPT + MAX_NUMBER_OF_DISKS - 1) {
             /* Note - if we get a disk error, we simply enqueued an event
              and incremented (hopefully momentarily) the disk_in_use value */
-            if (disk_state[event_type - DISK_INTERRUPT + 1].disk_in_use == FALSE) {
+            if (disk_state[event_type - DISK_INTERRUPT + 1].channels_in_use == 0) {
                 printf("False interrupt - the Z502 got an interrupt from a\n");
                 printf("DISK - but that disk wasn't in use.\n");
                 HardwareInternalPanic(ERR_Z502_INTERNAL_BUG);
             }
 
-            //  NOTE:  Here when we take a disk interrupt, we clear the busy of ALL
-            //  disks because we assume that the user will handle all of them with
-            //  the interrupt that's about to be done.
-            for (index = DISK_INTERRUPT ;
-                 index <= DISK_INTERRUPT + MAX_NUMBER_OF_DISKS - 1;
-                 index++) {
-                if ( (STAT_VECTOR[SV_ACTIVE ][index] != 0)
-                        && (STAT_VECTOR[SV_TID    ][index] == GetMyTid()  ) ) {
-                    // Bugfix 08/2012 - disk_state contains MAX_NUMBER_OF_DISKS elements
-                    // We were spraying some unknown memory locations
-                    disk_state[index - DISK_INTERRUPT ].disk_in_use = FALSE;
-                    // printf("3. Setting %d FALSE\n", index );
-                }
-            }
-            //  We MAYBE should be clearing all these as well - and not just the current one.
-
-            disk_state[event_type - DISK_INTERRUPT + 1].disk_in_use = FALSE;
+            //  NOTE:  This used to clear the busy of ALL disks with a pending
+            //  interrupt.  Now that a disk can have several transfers going,
+            //  each event frees only the channel of the transfer it is for;
+            //  the others get freed by their own events.
+            FinishDiskChannel((INT16) (event_type - DISK_INTERRUPT + 1),
+                    (INT32) time_of_event);
             // printf("3. Setting %d FALSE\n", event_type );
             disk_state[event_type - DISK_INTERRUPT + 1].event_ptr = NULL;
         }
@@ -1872,7 +2418,20 @@ void PrintHardwareStats(void) {
                     HardwareStats.disk_reads[i], HardwareStats.disk_writes[i]);
             util = (double) HardwareStats.time_disk_busy[i]
                     / (double) CurrentSimulationTime;
-            printf("Disk Utilization = %6.3f\n", util);
+            // The busy time of a solid state disk is summed over all the channels
+            if (disk_state[i].type == DISK_TYPE_SSD)
+                util = util / SSD_CHANNELS;
+            printf("Disk Utilization = %6.3f", util);
+            if (disk_state[i].type == DISK_TYPE_SSD)
+                printf(": Sectors Trimmed = %5d", HardwareStats.disk_trims[i]);
+            if (disk_state[i].cache_size > 0 || disk_state[i].write_cache_size > 0)
+                printf(": Cache Hits = %5d", HardwareStats.disk_cache_hits[i]);
+            if (disk_state[i].write_cache_size > 0)
+                printf(": Cached Writes = %5d: FUA = %5d: Flushes = %5d: Unsaved = %d",
+                        HardwareStats.disk_cached_writes[i],
+                        HardwareStats.disk_fua_writes[i],
+                        HardwareStats.disk_flushes[i], WriteCacheUnsaved((INT16) i));
+            printf("\n");
         }
     }
     if (HardwareStats.number_faults > 0)
@@ -2013,6 +2572,36 @@ void CreateSectorStruct(INT16 disk_id, INT16 sector, char **returned_sector_ptr)
 
 }                                    // End of CreateSectorStruct
 
+/*****************************************************************
+
+ RemoveSectorStruct()
+
+ Takes the count sectors from sector on off the list of valid
+ sectors for a disk and frees them, as though they had never been
+ written.  Those that were never written are left alone.
+ *****************************************************************/
+
+void RemoveSectorStruct(INT16 disk_id, INT16 sector, INT32 count) {
+    SECTOR *ssp;
+    INT32 **link;
+
+    link = &sector_queue[disk_id].queue;
+    while (*link != NULL) {
+        ssp = (SECTOR *) *link;
+        if (ssp->structure_id != SECTOR_STRUCTURE_ID) {
+            printf("Bad structure id read in RemoveSectorStruct.\n");
+            HardwareInternalPanic(ERR_Z502_INTERNAL_BUG);
+        }
+        if (ssp->disk_id == disk_id && ssp->sector >= sector
+                && ssp->sector < sector + count) {
+            *link = ssp->queue;
+            free(ssp);
+            continue;
+        }
+        link = &ssp->queue;
+    }
+}                                    // End of RemoveSectorStruct
+
 /**************************************************************************
  **************************************************************************
  THREAD MANAGER
@@ -2273,9 +2862,11 @@ void SuspendProcessExecution(Z502CONTEXT *Context) {
         printf("SERIOUS ERROR:  The initial thread has become unsuspended\n");
         return;
     }
-    // Find target Context in the table & make sure all is OK
+    // Find target Context in the table & make sure all is OK.
+    // We only ever suspend ourselves, so look for our own thread; our
+    // context may already have been destroyed and detached by now.
     for (i = 0; i < MAX_NUMBER_OF_USER_THREADS; i++) {
-        if (ThreadTable[i].Context == Context) {
+        if (ThreadTable[i].ThreadID == GetMyTid()) {
             ourLocalID = i;
             break;
         }
@@ -3090,7 +3681,7 @@ void GoToExit(int Value) {
  *****************************************************************/
 
 void Z502Init() {
-    INT16 i;
+    INT16 i, j;
 
     if (Z502Initialized == FALSE) {
         // Show that we've been in this code.
@@ -3114,6 +3705,26 @@ void Z502Init() {
             HardwareStats.disk_writes[i] = 0;
             HardwareStats.time_disk_busy[i] = 0;
         }
+        for (i = 1; i <= MAX_NUMBER_OF_DISKS ; i++) {
+            disk_state[i].type = DISK_TYPE_SPINNING;
+            disk_state[i].channels_in_use = 0;
+            for (j = 0; j < SSD_CHANNELS; j++)
+                disk_state[i].channel_done_at[j] = -1;
+            disk_state[i].next_tag = -1;
+            disk_state[i].completed_tag = -1;
+            disk_state[i].cache_policy = DISK_CACHE_AHEAD;
+            disk_state[i].cache_size = 0;
+            disk_state[i].cache_count = 0;
+            disk_state[i].write_cache_size = 0;
+            for (j = 0; j < WRITE_CACHE_MAX; j++)
+                disk_state[i].write_cache_clean_at[j] = 0;
+            disk_state[i].media_free_at = 0;
+            HardwareStats.disk_trims[i] = 0;
+            HardwareStats.disk_cache_hits[i] = 0;
+            HardwareStats.disk_cached_writes[i] = 0;
+            HardwareStats.disk_fua_writes[i] = 0;
+            HardwareStats.disk_flushes[i] = 0;
+        }
         HardwareStats.context_switches = 0;
         HardwareStats.number_charge_times = 0;
         HardwareStats.number_faults = 0;
@@ -33,6 +33,24 @@
 #define         COST_OF_CPU_INSTRUCTION         1L
 #define         COST_OF_CALL                    2L
 
+        /*  How long a solid state disk takes, on any one channel */
+
+#define         SSD_READ_TIME                   25L
+#define         SSD_WRITE_TIME                  50L
+#define         SSD_TRIM_TIME                   10L
+
+        /*  How long a spinning disk takes to hand over a sector that
+            is already in its track cache                           */
+
+#define         TRACK_CACHE_HIT_TIME            10L
+
+        /*  How long a spinning disk takes to take a write into its
+            write cache, or to answer a flush with nothing to write */
+
+#define         WRITE_CACHE_ACK_TIME            10L
+
+#define         LATER_OF(a, b)                  ((a) > (b) ? (a) : (b))
+
 #ifndef NULL
 #define         NULL                            0
 #endif
@@ -81,6 +99,11 @@ typedef struct
     INT32               disk_reads[MAX_NUMBER_OF_DISKS];
     INT32               disk_writes[MAX_NUMBER_OF_DISKS];
     INT32               time_disk_busy[MAX_NUMBER_OF_DISKS];
+    INT32               disk_trims[MAX_NUMBER_OF_DISKS + 1];
+    INT32               disk_cache_hits[MAX_NUMBER_OF_DISKS + 1];
+    INT32               disk_cached_writes[MAX_NUMBER_OF_DISKS + 1];
+    INT32               disk_fua_writes[MAX_NUMBER_OF_DISKS + 1];
+    INT32               disk_flushes[MAX_NUMBER_OF_DISKS + 1];
     INT32               number_charge_times;
     INT32               number_mask_set_seen;
     INT32               number_faults;
@@ -134,8 +157,23 @@ typedef struct
 {
     EVENT               *event_ptr;
     INT16               last_sector;
-    INT16               disk_in_use;
+    INT16               disk_in_use;        // TRUE while every channel is busy
     INT16               action;
+    INT16               type;               // DISK_TYPE_SPINNING or DISK_TYPE_SSD
+    INT16               channels_in_use;
+    INT32               channel_done_at[SSD_CHANNELS];  // when each channel finishes
+    INT32               channel_started[SSD_CHANNELS];  // order they were started in
+    INT32               channel_tag[SSD_CHANNELS];
+    INT32               next_tag;           // given to the next transfer started
+    INT32               completed_tag;      // of the transfer the last interrupt was for
+    INT16               cache_policy;       // DISK_CACHE_AHEAD or DISK_CACHE_TRACK
+    INT32               cache_size;         // sectors the track cache holds, 0 if it has none
+    INT32               cache_first;        // the sectors it holds right now
+    INT32               cache_count;
+    INT32               write_cache_size;   // writes its write cache holds, 0 if it has none
+    INT32               write_cache_sector[WRITE_CACHE_MAX];
+    INT32               write_cache_clean_at[WRITE_CACHE_MAX];  // when each is on the platter
+    INT32               media_free_at;      // when the platter is done with all it has been given
 } DISK_STATE;
 
 typedef struct
@@ -143,6 +181,8 @@ typedef struct
     INT16               sector;
     INT16               action;
     char                *buffer;
+    INT32               tag;
+    INT32               count;
 } MEMORY_MAPPED_DISK_STATE;
 
 typedef struct